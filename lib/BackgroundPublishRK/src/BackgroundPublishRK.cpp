@@ -28,7 +28,23 @@ void BackgroundPublish::start()
 {
     if(!thread)
     {
-        os_mutex_create(&mutex);
+        if(!requestQueue)
+        {
+            os_mutex_create(&mutex);
+            os_queue_create(&requestQueue, sizeof(uint8_t), BACKGROUND_PUBLISH_QUEUE_SLOTS + 1, NULL);
+            os_queue_create(&freeQueue, sizeof(uint8_t), BACKGROUND_PUBLISH_QUEUE_SLOTS, NULL);
+            os_semaphore_create(&completedSemaphore, 1, 0);
+        }
+
+        // every slot starts out free - drain first in case we were stopped and restarted
+        uint8_t slot;
+        while(os_queue_take(freeQueue, &slot, 0, NULL) == 0) {}
+        while(os_queue_take(requestQueue, &slot, 0, NULL) == 0) {}
+        for(slot = 0; slot < BACKGROUND_PUBLISH_QUEUE_SLOTS; slot++)
+        {
+            os_queue_put(freeQueue, &slot, 0, NULL);
+        }
+        state = BACKGROUND_PUBLISH_IDLE;
 
         // use OS_THREAD_PRIORITY_DEFAULT so that application, system, and
         // background publish thread will all run at the same priority and
@@ -43,8 +59,12 @@ void BackgroundPublish::stop()
 {
     if(thread)
     {
+        uint8_t stopRequest = STOP_REQUEST;
+
         state = BACKGROUND_PUBLISH_STOP;
-        thread->dispose();
+        os_queue_put(requestQueue, &stopRequest, CONCURRENT_WAIT_FOREVER, NULL);  // wakes the thread if it is idle
+        os_semaphore_give(completedSemaphore, false);                            // or if it is waiting on a publish
+        thread->join();
         delete thread;
         thread = NULL;
     }
@@ -54,99 +74,106 @@ void BackgroundPublish::thread_f()
 {
     while(true)
     {
-        while(state == BACKGROUND_PUBLISH_IDLE)
+        uint8_t slot;
+
+        // block until there is something to publish - no CPU is used while idle
+        if(os_queue_take(requestQueue, &slot, CONCURRENT_WAIT_FOREVER, NULL) != 0)
         {
-            // yield to rest of system while we wait
-            // a condition variable would be ideal but doesn't look like
-            // std::condition_variable is supported
-            delay(1);
+            continue;
         }
 
-        if(state == BACKGROUND_PUBLISH_STOP)
+        if(slot == STOP_REQUEST || state == BACKGROUND_PUBLISH_STOP)
         {
             return;
         }
 
+        PublishRequest &request = requests[slot];
+
         // temporarily acquire the lock
         // this allows a calling thread to block the publish thread if it needs
         // additional synchronization around a publish request and acts as a
         // memory barrier around publish arguments to ensure all updates
         // are complete
         lock();
+        state = BACKGROUND_PUBLISH_REQUESTED;
         unlock();
 
         // kick off the publish
         // WITH_ACK does not work as expected from a background thread
-        // use the Future<bool> object directly as its default wait
-        // (used by WITH_ACK) short-circuits when not called from the
-        // main application thread
-        auto ok = Particle.publish(event_name, event_data, event_flags);
+        // use the Future<bool> object directly and block until its
+        // completion callbacks signal the semaphore
+        auto ok = Particle.publish(request.event_name, request.event_data, request.event_flags);
+        ok.onSuccess([this](bool) { os_semaphore_give(completedSemaphore, false); });
+        ok.onError([this](particle::Error) { os_semaphore_give(completedSemaphore, false); });
 
-        // then wait for publish to complete
         while(!ok.isDone() && state != BACKGROUND_PUBLISH_STOP)
         {
-            // yield to rest of system while we wait
-            delay(1);
+            os_semaphore_take(completedSemaphore, CONCURRENT_WAIT_FOREVER, false);
         }
 
-        if(completed_cb)
+        if(request.completed_cb)
         {
-            completed_cb(ok.isSucceeded(),
-                event_name,
-                event_data,
-                event_context);
+            request.completed_cb(ok.isSucceeded(),
+                request.event_name,
+                request.event_data,
+                request.event_context);
         }
 
         WITH_LOCK(*this)
         {
+            request.event_context = NULL;
+            request.completed_cb = NULL;
             if(state == BACKGROUND_PUBLISH_STOP)
             {
                 return;
             }
-            event_context = NULL;
-            completed_cb = NULL;
             state = BACKGROUND_PUBLISH_IDLE;
         }
+        os_queue_put(freeQueue, &slot, 0, NULL);
     }
 }
 
 bool BackgroundPublish::publish(const char *name, const char *data, PublishFlags flags, PublishCompletedCallback cb, const void *context)
 {
-    // protect against separate threads trying to publish at the same time
-    WITH_LOCK(*this)
-
-    // check currently in idle state and ready to accept publish request
-    if(!thread || state != BACKGROUND_PUBLISH_IDLE)
-    {
-        return false;
-    }
+    uint8_t slot;
 
     // event name is required to publish
     // all other arguments may be be left out or defaulted
-    if(!name)
+    if(!thread || state == BACKGROUND_PUBLISH_STOP || !name)
     {
         return false;
     }
 
-    // have the lock and thread is currently idle
-    // safe to prepare publish request
-    strncpy(event_name, name, sizeof(event_name));
-    event_name[sizeof(event_name)-1] = '\0'; // ensure null termination
-
-    if(data)
-    {
-        strncpy(event_data, data, sizeof(event_data));
-        event_data[sizeof(event_data)-1] = '\0'; // ensure null termination
-    }
-    else
+    // protect against separate threads trying to publish at the same time
+    WITH_LOCK(*this)
     {
-        event_data[0] = '\0'; // null terminate at start for no event data
-    }
+        // take a free slot without waiting - false if they are all queued or publishing
+        if(os_queue_take(freeQueue, &slot, 0, NULL) != 0)
+        {
+            return false;
+        }
+
+        PublishRequest &request = requests[slot];
+
+        strncpy(request.event_name, name, sizeof(request.event_name));
+        request.event_name[sizeof(request.event_name)-1] = '\0'; // ensure null termination
 
-    completed_cb = cb;
-    event_context = context;
-    event_flags = flags;
-    state = BACKGROUND_PUBLISH_REQUESTED;
+        if(data)
+        {
+            strncpy(request.event_data, data, sizeof(request.event_data));
+            request.event_data[sizeof(request.event_data)-1] = '\0'; // ensure null termination
+        }
+        else
+        {
+            request.event_data[0] = '\0'; // null terminate at start for no event data
+        }
+
+        request.completed_cb = cb;
+        request.event_context = context;
+        request.event_flags = flags;
+
+        os_queue_put(requestQueue, &slot, 0, NULL);  // room for every slot plus the stop request
+    }
 
     return true;
 }
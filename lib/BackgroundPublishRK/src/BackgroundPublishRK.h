@@ -7,6 +7,17 @@
 
 #include <protocol_defs.h>
 
+/**
+ * @brief Number of publish requests that can be waiting (including the one being published)
+ *
+ * Each slot holds a full event name and data buffer - MAX_EVENT_DATA_LENGTH is 1024 on Device OS 4.x, so about
+ * 1.1 KB of static RAM per slot. PublishQueuePosix has one event in flight at a time, so one slot is enough for
+ * it. You can override this by defining it before including this file or in the build flags.
+ */
+#ifndef BACKGROUND_PUBLISH_QUEUE_SLOTS
+#define BACKGROUND_PUBLISH_QUEUE_SLOTS 1
+#endif
+
 /**
  * @brief Internal state of the publish thread
  */
@@ -72,6 +83,9 @@ public:
     /**
      * @brief Publish method. Use this instead of Particle.publish().
      *
+     * The request is copied into a free slot and queued for the publish thread, so this returns immediately.
+     * Returns false only if all BACKGROUND_PUBLISH_QUEUE_SLOTS are in use (or the thread is not started).
+     *
      * @param name Event name to publish (required)
      *
      * @param data Event data (optional). Must be a c-string (null-terminated) if non-NULL.
@@ -130,18 +144,30 @@ private:
     BackgroundPublish& operator=(const BackgroundPublish&) = delete;
 
 
+    /**
+     * @brief One queued publish request
+     */
+    struct PublishRequest {
+        // arguments for Particle.publish
+        char event_name[particle::protocol::MAX_EVENT_NAME_LENGTH+1];	//!< name passed to publish
+        char event_data[particle::protocol::MAX_EVENT_DATA_LENGTH+1];	//!< event data passed to publish (may be empty string)
+        PublishFlags event_flags; 	//!< event flags, typically PRIVATE, PRIVATE | WITH_ACK, or PRIVATE | NO_ACK.
+        // callback when publish completes
+        PublishCompletedCallback completed_cb; 	//!< Completion callback (optional)
+        const void *event_context; 		//!< Context passed to completion (optional)
+    };
+
+    static const uint8_t STOP_REQUEST = 0xff;	//!< Queued in place of a slot index to stop the thread
+
     Thread *thread = NULL;		//!< Thread object pointer. Allocated during start()
     void thread_f();			//!< Thread function, passed to the Thread object
     os_mutex_t mutex;	//!< Mutex to protect access to class members from multiple threads
     volatile publish_thread_state_t state = BACKGROUND_PUBLISH_IDLE; //!< Current state
 
-    // arguments for Particle.publish
-    char event_name[particle::protocol::MAX_EVENT_NAME_LENGTH+1];	//!< name passed to publish
-    char event_data[particle::protocol::MAX_EVENT_DATA_LENGTH+1];	//!< event data passed to publish (may be empty string)
-    PublishFlags event_flags; 	//!< event flags, typically PRIVATE, PRIVATE | WITH_ACK, or PRIVATE | NO_ACK.
-    // callback when publish completes
-    PublishCompletedCallback completed_cb = NULL; 	//!< Completion callback (optional)
-    const void *event_context = NULL; 		//!< Context passed to completion (optional)
+    os_queue_t requestQueue = NULL;	//!< Slot indexes waiting to be published - the thread blocks on this
+    os_queue_t freeQueue = NULL;		//!< Slot indexes available to publish()
+    os_semaphore_t completedSemaphore = NULL;	//!< Given by the Future callbacks when a publish completes
+    PublishRequest requests[BACKGROUND_PUBLISH_QUEUE_SLOTS];	//!< Request slots
 
     static BackgroundPublish *_instance; //!< Singleton instance of this class
 };
@@ -395,6 +395,35 @@ public:
 		}
 	}
 
+	/**
+	 * @brief Given an object token in container, gets the value with the specified key name as a c-string
+	 * in a caller supplied buffer - no heap allocation.
+	 *
+	 * @param container The token for the object to obtain the data from.
+	 *
+	 * @param name The name of the key to retrieve
+	 *
+	 * @param result Buffer for the value. It is always null terminated and set to an empty string if the key
+	 * is not present. A value that is too long is truncated.
+	 *
+	 * @param resultLen Size of the result buffer in bytes (including the null)
+	 *
+	 * @result true if the data was retrieved successfully, false if the key is not present.
+	 */
+	bool getValueByKey(const JsonParserGeneratorRK::jsmntok_t *container, const char *name, char *result, size_t resultLen) const {
+		const JsonParserGeneratorRK::jsmntok_t *value;
+
+		if (resultLen > 0) {
+			result[0] = 0;
+		}
+		if (getValueTokenByKey(container, name, value)) {
+			return getTokenValue(value, result, resultLen);
+		}
+		else {
+			return false;
+		}
+	}
+
 	/**
 	 * @brief Gets the value with the specified key name out of the outer object.
 	 *
@@ -435,6 +435,36 @@ LocalTimePosixTimezone::LocalTimePosixTimezone(const char *str) {
     parse(str);
 }
 
+LocalTimePosixTimezone::LocalTimePosixTimezone(const LocalTimeRule &rule) {
+    if (!rule.valid) {
+        return;
+    }
+    standardName = rule.standardName;
+    standardHMS.hour = rule.standardHMS.hour;
+    standardHMS.minute = rule.standardHMS.minute;
+    standardHMS.second = rule.standardHMS.second;
+
+    if (rule.hasDST()) {
+        dstName = rule.dstName;
+        dstHMS.hour = rule.dstHMS.hour;
+        dstHMS.minute = rule.dstHMS.minute;
+        dstHMS.second = rule.dstHMS.second;
+
+        const LocalTimeRule::Change *ruleChanges[2] = { &rule.dstStart, &rule.standardStart };
+        LocalTimeChange *changes[2] = { &dstStart, &standardStart };
+        for(size_t ii = 0; ii < 2; ii++) {
+            changes[ii]->month = ruleChanges[ii]->month;
+            changes[ii]->week = ruleChanges[ii]->week;
+            changes[ii]->dayOfWeek = ruleChanges[ii]->dayOfWeek;
+            changes[ii]->hms.hour = ruleChanges[ii]->hms.hour;
+            changes[ii]->hms.minute = ruleChanges[ii]->hms.minute;
+            changes[ii]->hms.second = ruleChanges[ii]->hms.second;
+            changes[ii]->valid = true;
+        }
+    }
+    valid = true;
+}
+
 void LocalTimePosixTimezone::clear() {
     dstStart.clear();
     dstName = "";
@@ -1338,17 +1368,37 @@ void LocalTimeConvert::atLocalTime(LocalTimeHMS hms) {
 
 
 String LocalTimeConvert::timeStr() {
+    char ascstr[26];
+    timeStr(ascstr, sizeof(ascstr));
+    return String(ascstr);
+}
+
+size_t LocalTimeConvert::timeStr(char *buf, size_t bufLen) {
+    if (bufLen == 0) {
+        return 0;
+    }
     char ascstr[26];
     asctime_r(&localTimeValue, ascstr);
-    int len = strlen(ascstr);
+    size_t len = strlen(ascstr);
     ascstr[len-1] = 0; // remove final newline
-    return String(ascstr);
+    strncpy(buf, ascstr, bufLen - 1);
+    buf[bufLen - 1] = 0;
+    return strlen(buf);
 }
 
 String LocalTimeConvert::format(const char* format_spec) {
+    char buf[50];
+    format(format_spec, buf, sizeof(buf));
+    return String(buf);    
+}
+
+size_t LocalTimeConvert::format(const char* format_spec, char *buf, size_t bufLen) {
+    if (bufLen == 0) {
+        return 0;
+    }
 
     if (!format_spec || !strcmp(format_spec, TIME_FORMAT_DEFAULT)) {
-        return timeStr();
+        return timeStr(buf, bufLen);
     }
 
     // This implementation is from spark_wiring_time.cpp
@@ -1360,7 +1410,8 @@ String LocalTimeConvert::format(const char* format_spec) {
     size_t len = strlen(format_str); // Flawfinder: ignore (ch42318)
 
     // while we are not using stdlib for managing the timezone, we have to do this manually
-    String zoneNameStr = zoneName();
+    // (the name is used in place - zoneName() would copy it into a String)
+    const char *zoneNameStr = config.isZ() ? "Z" : (isDST() ? config.dstName.c_str() : config.standardName.c_str());
 
     char time_zone_str[16];
     if (config.isZ()) {
@@ -1385,16 +1436,18 @@ String LocalTimeConvert::format(const char* format_spec) {
         else
         if (format_str[i]=='%' && format_str[i+1]=='Z')
         {
-            size_t tzlen = zoneNameStr.length();
+            size_t tzlen = strlen(zoneNameStr);
             memcpy(format_str+i+tzlen, format_str+i+2, len-i-1);    // +1 include the 0 char
-            memcpy(format_str+i, zoneNameStr.c_str(), tzlen);
+            memcpy(format_str+i, zoneNameStr, tzlen);
             len = strlen(format_str);
         }
     }
 
-    char buf[50] = {};
-    strftime(buf, sizeof(buf), format_str, &localTimeValue);
-    return String(buf);    
+    size_t result = strftime(buf, bufLen, format_str, &localTimeValue);
+    if (result == 0) {
+        buf[0] = 0;
+    }
+    return result;
 }
 
 String LocalTimeConvert::zoneName() const { 
@@ -1479,14 +1532,25 @@ time_t LocalTime::stringToTime(const char *str, struct tm *pTimeInfo) {
 
 // [static]
 String LocalTime::timeToString(time_t time, char separator) {
+    char buf[32];
+    timeToString(time, buf, sizeof(buf), separator);
+    return String(buf);
+}
+
+// [static]
+size_t LocalTime::timeToString(time_t time, char *buf, size_t bufLen, char separator) {
     struct tm timeInfo;
 
     timeToTm(time, &timeInfo);
 
-    return String::format("%04d-%02d-%02d%c%02d:%02d:%02d", 
+    int len = snprintf(buf, bufLen, "%04d-%02d-%02d%c%02d:%02d:%02d", 
         timeInfo.tm_year + 1900, timeInfo.tm_mon + 1, timeInfo.tm_mday,
         separator,
         timeInfo.tm_hour, timeInfo.tm_min, timeInfo.tm_sec);
+    if (len < 0 || bufLen == 0) {
+        return 0;
+    }
+    return ((size_t)len < bufLen) ? (size_t)len : bufLen - 1;
 }
 
 
@@ -928,6 +928,143 @@ public:
 };
 
 
+/**
+ * @brief A Posix timezone string parsed into a packed, trivially copyable rule
+ * 
+ * Unlike LocalTimePosixTimezone this can be built at compile time, so a fixed timezone costs no parsing
+ * at boot, and it can be stored as-is in FRAM or EEPROM:
+ * 
+ * ```
+ * constexpr LocalTimeRule easternRule = LocalTimeRule::parse("EST5EDT,M3.2.0/2:00:00,M11.1.0/2:00:00");
+ * static_assert(easternRule.valid, "Bad timezone rule");
+ * LocalTime::instance().withConfig(LocalTimePosixTimezone(easternRule));
+ * ```
+ * 
+ * The same formats as LocalTimePosixTimezone::parse() are accepted except that names are truncated to
+ * MAX_NAME characters and anything left over after the rule makes it invalid. parse() can also be called
+ * at run time, for example on a rule received from the cloud.
+ */
+struct LocalTimeRule {
+    static const size_t MAX_NAME = 5;   //!< Longest timezone name kept - "AEST" and "ACDT" fit
+
+    /**
+     * @brief Time of day or UTC offset - same sign convention as LocalTimeHMS (only the hour is negative)
+     */
+    struct HMS {
+        int8_t hour;
+        int8_t minute;
+        int8_t second;
+    };
+
+    /**
+     * @brief Time change like "M3.2.0/2:00:00" - see LocalTimeChange
+     */
+    struct Change {
+        int8_t month;       //!< 1-12, 1=January, 0 = no time change
+        int8_t week;        //!< 1-5, 5=last
+        int8_t dayOfWeek;   //!< 0-6, 0=Sunday
+        HMS hms;            //!< Local time when the change occurs
+    };
+
+    char standardName[MAX_NAME + 1];    //!< Standard time timezone name
+    HMS standardHMS;                    //!< Standard time shift (positive west of UTC, like Posix)
+    char dstName[MAX_NAME + 1];         //!< Daylight saving timezone name (empty if no DST)
+    HMS dstHMS;                         //!< Daylight saving time shift
+    Change dstStart;                    //!< When DST starts
+    Change standardStart;               //!< When standard time starts
+    bool valid;                         //!< true if the whole string was understood
+
+    /**
+     * @brief Parses a Posix timezone string like "EST5EDT,M3.2.0/2:00:00,M11.1.0/2:00:00"
+     * 
+     * @param str The string. A null or malformed string returns a rule with valid false.
+     */
+    static constexpr LocalTimeRule parse(const char *str) {
+        LocalTimeRule rule{};
+        if (!str) return rule;
+
+        size_t pos = 0;
+        if (!parseName(str, pos, rule.standardName)) return rule;
+        if (str[pos] && !parseHMS(str, pos, rule.standardHMS)) return rule;       // "UTC" alone is allowed
+
+        if (str[pos] >= 'A') {
+            parseName(str, pos, rule.dstName);
+            if (str[pos] && str[pos] != ',') {
+                if (!parseHMS(str, pos, rule.dstHMS)) return rule;
+            }
+            else {
+                rule.dstHMS = rule.standardHMS;     // Default dst is 1 hour later
+                rule.dstHMS.hour--;
+            }
+            if (str[pos] == ',') {
+                pos++;
+                if (!parseChange(str, pos, rule.dstStart) || str[pos++] != ',') return rule;
+                if (!parseChange(str, pos, rule.standardStart)) return rule;
+            }
+        }
+        rule.valid = (str[pos] == 0) && ((rule.dstStart.month == 0) == (rule.standardStart.month == 0));
+        return rule;
+    }
+
+    /**
+     * @brief Returns true if the rule has daylight saving
+     */
+    constexpr bool hasDST() const { return dstStart.month != 0; }
+
+private:
+    static constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    static constexpr bool parseName(const char *str, size_t &pos, char (&name)[MAX_NAME + 1]) {
+        size_t len = 0;
+        for (; str[pos] >= 'A'; pos++) {
+            if (len < MAX_NAME) name[len++] = str[pos];
+        }
+        name[len] = 0;
+        return len > 0;
+    }
+
+    static constexpr bool parseInt(const char *str, size_t &pos, int &value) {
+        bool negative = false;
+        if (str[pos] == '+' || str[pos] == '-') negative = (str[pos++] == '-');
+        if (!isDigit(str[pos])) return false;
+        value = 0;
+        for (; isDigit(str[pos]); pos++) value = value * 10 + (str[pos] - '0');
+        if (negative) value = -value;
+        return true;
+    }
+
+    static constexpr bool parseHMS(const char *str, size_t &pos, HMS &hms) {
+        int value = 0;
+        if (!parseInt(str, pos, value) || value < -24 || value > 24) return false;
+        hms.hour = (int8_t) value;
+        if (str[pos] != ':') return true;
+        pos++;
+        if (!parseInt(str, pos, value) || value < 0 || value > 59) return false;
+        hms.minute = (int8_t) value;
+        if (str[pos] != ':') return true;
+        pos++;
+        if (!parseInt(str, pos, value) || value < 0 || value > 59) return false;
+        hms.second = (int8_t) value;
+        return true;
+    }
+
+    static constexpr bool parseChange(const char *str, size_t &pos, Change &change) {
+        int month = 0, week = 0, dayOfWeek = 0;
+        if (str[pos++] != 'M' || !parseInt(str, pos, month) || month < 1 || month > 12) return false;
+        if (str[pos++] != '.' || !parseInt(str, pos, week) || week < 1 || week > 5) return false;
+        if (str[pos++] != '.' || !parseInt(str, pos, dayOfWeek) || dayOfWeek < 0 || dayOfWeek > 6) return false;
+        change.month = (int8_t) month;
+        change.week = (int8_t) week;
+        change.dayOfWeek = (int8_t) dayOfWeek;
+        change.hms = HMS{};                     // Midnight if no time is given
+        if (str[pos] == '/') {
+            pos++;
+            return parseHMS(str, pos, change.hms);
+        }
+        return true;
+    }
+};
+
 /**
  * @brief Handles the time change part of the Posix timezone string like "M3.2.0/2:00:00"
  * 
@@ -1043,6 +1180,14 @@ public:
      */
     LocalTimePosixTimezone(const char *str);
 
+    /**
+     * @brief Constructs the object from a rule that has already been parsed - no string parsing is done
+     * 
+     * The rule is typically built at compile time with LocalTimeRule::parse(). An invalid rule
+     * gives an invalid (UTC) timezone.
+     */
+    LocalTimePosixTimezone(const LocalTimeRule &rule);
+
     /**
      * @brief Clears the timezone setting in this object
      */
@@ -2126,6 +2271,16 @@ public:
      */
     String timeStr();
 
+    /**
+     * @brief Like timeStr() but into a caller supplied buffer - no heap allocation
+     * 
+     * @param buf Buffer for the string. Needs to be 25 bytes for the whole string.
+     * @param bufLen Size of buf in bytes
+     * 
+     * @returns The number of characters written (not including the null)
+     */
+    size_t timeStr(char *buf, size_t bufLen);
+
     /**
      * @brief Works like Time.format()
      * 
@@ -2148,6 +2303,18 @@ public:
      */
     String format(const char* formatSpec);
 
+    /**
+     * @brief Like format(const char *) but into a caller supplied buffer - no heap allocation
+     * 
+     * @param formatSpec the format specifier, see format(const char *)
+     * @param buf Buffer for the formatted time
+     * @param bufLen Size of buf in bytes
+     * 
+     * @returns The number of characters written (not including the null). If the result does not fit
+     * buf is set to an empty string and 0 is returned.
+     */
+    size_t format(const char* formatSpec, char *buf, size_t bufLen);
+
     /**
      * @brief Returns the abbreviated time zone name for the current time
      * 
@@ -2341,6 +2508,18 @@ public:
      */
     static String timeToString(time_t time, char separator = ' ');
 
+    /**
+     * @brief Like timeToString(time_t, char) but into a caller supplied buffer - no heap allocation
+     * 
+     * @param time Unix time (seconds past Jan 1 1970) UTC
+     * @param buf Buffer for the string. Needs to be 20 bytes for the whole string.
+     * @param bufLen Size of buf in bytes
+     * @param separator the separator between the day of month and hour, typically T or a space.
+     * 
+     * @returns The number of characters written (not including the null)
+     */
+    static size_t timeToString(time_t time, char *buf, size_t bufLen, char separator = ' ');
+
     /**
      * @brief Returns the last day of the month in a given month and year
      * 
@@ -312,6 +312,11 @@ void PublishQueuePosix::stateWait() {
             })) {
             // Successfully started publish
         }
+        else {
+            // No free slot - BackgroundPublish returns the last one just after its completion callback.
+            // Handle it as a failed publish so it is retried instead of waiting here forever
+            publishComplete = true;
+        }
     }
 }
 void PublishQueuePosix::statePublishWait() {
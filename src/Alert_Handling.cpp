@@ -15,12 +15,38 @@ Alert_Handling &Alert_Handling::instance() {
   return *_instance;
 }
 
-Alert_Handling::Alert_Handling() {
+Alert_Handling::Alert_Handling() : pendingAlerts(0) {
 }
 
 Alert_Handling::~Alert_Handling() {
 }
 
+namespace {
+  void resetCountOnResolve() {
+    sysStatus.set_resetCount(0);                                   // Excessive resets - start counting again so we don't do this too often
+  }
+
+  // The alert policy table - ladders are indexed by how many times the alert has recurred inside the escalation window
+  // Note: the table is limited to MAX_ALERT_POLICIES rows as each row has a history slot in FRAM - never reorder existing rows
+  const Alert_Handling::AlertPolicy alertPolicies[] = {
+    // code severity                         minInterval  window      steps  ladder
+    {  2, Alert_Handling::ALERT_INFO,        0,           0,          1, {Alert_Handling::ALERT_SOFT_RESET},                   nullptr },   // Manual request for a soft reset
+    {  3, Alert_Handling::ALERT_INFO,        0,           0,          1, {Alert_Handling::ALERT_POWER_CYCLE},                  nullptr },   // Manual request for a power cycle
+    { 10, Alert_Handling::ALERT_INFO,        0,           0,          1, {Alert_Handling::ALERT_NO_ACTION},                    nullptr },   // Too hot / cold to charge
+    { 12, Alert_Handling::ALERT_CRITICAL,    60,          6 * 3600L,  2, {Alert_Handling::ALERT_REPORT, Alert_Handling::ALERT_POWER_CYCLE}, nullptr },   // Initialization error - report first, then power cycle
+    { 13, Alert_Handling::ALERT_CRITICAL,    60,          6 * 3600L,  2, {Alert_Handling::ALERT_REPORT, Alert_Handling::ALERT_POWER_CYCLE}, resetCountOnResolve },   // Excessive resets
+    { 14, Alert_Handling::ALERT_CRITICAL,    0,           0,          1, {Alert_Handling::ALERT_SOFT_RESET},                   nullptr },   // Out of memory
+    { 15, Alert_Handling::ALERT_WARNING,     60,          3 * 3600L,  2, {Alert_Handling::ALERT_SOFT_RESET, Alert_Handling::ALERT_POWER_CYCLE}, nullptr },   // Modem power down failure
+    { 30, Alert_Handling::ALERT_WARNING,     600,         2 * 3600L,  3, {Alert_Handling::ALERT_NO_ACTION, Alert_Handling::ALERT_SOFT_RESET, Alert_Handling::ALERT_POWER_CYCLE}, nullptr },   // Cellular but no Particle connection
+    { 31, Alert_Handling::ALERT_WARNING,     600,         9 * 3600L,  3, {Alert_Handling::ALERT_NO_ACTION, Alert_Handling::ALERT_NO_ACTION, Alert_Handling::ALERT_POWER_CYCLE}, nullptr },   // No connection - power cycle on the third failure in a row.  Window outlasts the 8 hour connect backoff
+    { 32, Alert_Handling::ALERT_WARNING,     0,           0,          1, {Alert_Handling::ALERT_SOFT_RESET},                   nullptr },   // Slow to connect - reset and keep trying
+    { 40, Alert_Handling::ALERT_WARNING,     600,         2 * 3600L,  4, {Alert_Handling::ALERT_NO_ACTION, Alert_Handling::ALERT_NO_ACTION, Alert_Handling::ALERT_NO_ACTION, Alert_Handling::ALERT_SOFT_RESET}, nullptr },   // No webhook response for 3+ hours
+  };
+
+  const uint8_t alertPolicyCount = sizeof(alertPolicies) / sizeof(alertPolicies[0]);
+  static_assert(sizeof(alertPolicies) / sizeof(alertPolicies[0]) <= Alert_Handling::MAX_ALERT_POLICIES, "Alert policy table is larger than the FRAM history");
+}
+
 void Alert_Handling::setup() {
 }
 
@@ -28,96 +54,91 @@ void Alert_Handling::loop() {
     // Put your code to run during the application thread loop here
 }
 
+int Alert_Handling::policyIndex(uint8_t code) const {
+  for (uint8_t i = 0; i < alertPolicyCount; i++) {
+    if (alertPolicies[i].code == code) return i;
+  }
+  return -1;
+}
+
+void Alert_Handling::raiseAlert(uint8_t code) {
+  int index = policyIndex(code);
+  if (index < 0) {
+    Log.info("Alert %d has no policy - ignoring", code);
+    return;
+  }
+
+  pendingAlerts.fetch_or(1UL << index);
+
+  int reportedIndex = policyIndex(current.get_alertCode());        // Report the most severe of the pending alerts
+  if (reportedIndex < 0 || alertPolicies[index].severity >= alertPolicies[reportedIndex].severity) {
+    current.set_alertCode(code);
+  }
+}
+
+bool Alert_Handling::alertsPending() const {
+  return pendingAlerts.load() != 0;
+}
+
+bool Alert_Handling::isPending(uint8_t code) const {
+  int index = policyIndex(code);
+  return index >= 0 && (pendingAlerts.load() & (1UL << index));
+}
+
+void Alert_Handling::clearEscalation(uint8_t code) {
+  int index = policyIndex(code);
+  if (index < 0) return;
+  alertStatus.set_escalationStep(index, 0);
+  alertStatus.set_lastOccurrence(index, 0);                        // Next occurrence starts at the bottom, not one step up
+}
+
 int Alert_Handling::alertResolution() { 
   char data[64];                                                   // Let's publish to let folks know what is going on
-  int resolutionCode = 0;                                          // Default to no resolution
-  
-  if (current.get_alertCode() > 10) {
-    snprintf(data, sizeof(data), "{\"alerts\":%i,\"timestamp\":%lu000 }",current.get_alertCode(), Time.now());
-    PublishQueuePosix::instance().publish("Ubidots_Alert_Hook", data, PRIVATE);
-    Log.info(data);
+  AlertAction resolutionCode = ALERT_NO_ACTION;                    // Default to no resolution
+  uint32_t pending = pendingAlerts.exchange(0);                    // Take all the pending alerts - new ones will wait for the next pass
+
+  for (uint8_t i = 0; i < alertPolicyCount; i++) {
+    if (!(pending & (1UL << i))) continue;
+
+    const AlertPolicy &policy = alertPolicies[i];
+    time_t lastOccurrence = alertStatus.get_lastOccurrence(i);
+    uint8_t step = alertStatus.get_escalationStep(i);
+    time_t sinceLast = Time.now() - lastOccurrence;
+    AlertAction action;
+
+    if (policy.severity > ALERT_INFO) {
+      snprintf(data, sizeof(data), "{\"alerts\":%i,\"timestamp\":%lu000 }", policy.code, Time.now());
+      PublishQueuePosix::instance().publish("Ubidots_Alert_Hook", data, PRIVATE);
+      Log.info("%s", data);
+    }
+
+    if (lastOccurrence == 0 || sinceLast > (time_t)policy.escalationWindow) step = 0;   // First time or it has been quiet - start at the bottom of the ladder
+    else if (sinceLast < (time_t)policy.minInterval) {                                  // Recurring faster than we want to act on it - count it and carry on
+      alertStatus.set_occurrences(i, alertStatus.get_occurrences(i) + 1);
+      Log.info("Alert %d rate limited - no action", policy.code);
+      if (policy.onResolve) policy.onResolve();                    // Still resolved - or alert 13 would come back on every boot
+      continue;
+    }
+    else if (step < policy.ladderSteps - 1) step++;                                     // Recurred inside the window - escalate
+
+    action = policy.ladder[step];
+    Log.info("Alert %d occurrence %d at step %d - action %d", policy.code, alertStatus.get_occurrences(i) + 1, step, action);
+
+    alertStatus.set_occurrences(i, alertStatus.get_occurrences(i) + 1);
+    if (action >= ALERT_SOFT_RESET) {                              // A reset or power cycle starts the ladder over - the next occurrence is a first one
+      alertStatus.set_escalationStep(i, 0);
+      alertStatus.set_lastOccurrence(i, 0);
+    }
+    else {
+      alertStatus.set_escalationStep(i, step);
+      alertStatus.set_lastOccurrence(i, Time.now());
+    }
+
+    if (policy.onResolve) policy.onResolve();
+    if (action > resolutionCode) resolutionCode = action;
   }
 
-  switch (current.get_alertCode()) {                              // The resolution of the alert will depend on the value and the history
-    case 0:
-      resolutionCode = 0;                                         // Default - no action will be taken
-      break;
-
-    case 2:                                                       // This is a manual request for a soft reset
-      resolutionCode = 2;                                         // This will generate a soft reset
-      break;  
-
-    case 3:                                                       // This is a manal request for a poower cycle reset
-      resolutionCode = 3;                                         // This will generate a hard reset
-      break;
-
-    case 10:                                                      // Too hot / too cold to charge
-      Log.info("Too hot / cold to charge");
-      resolutionCode = 0;                                         // Default - no action will be taken
-      break;
-
-    case 12:                                                       // This is an initialization error - likely FRAM - need to power cycle to clear
-      if (Time.now() - sysStatus.get_lastConnection() > 3600L) {
-        Log.info("Initialization error - reporting");
-        sysStatus.set_lastConnection(Time.now());                  // Keep us from looping here
-        resolutionCode = 1;                                        // This will generate a report
-      }
-      Log.info("Initialization error  - power cycle");
-      resolutionCode = 3;                                         // This will generate a hard reset
-      break;
-
-    case 13:                                                       // Excessive resets of the device - time to power cycle
-      sysStatus.set_resetCount(0);                                 // Reset so we don't do this too often
-      if (Time.now() - sysStatus.get_lastConnection() > 3600L) {
-        sysStatus.set_lastConnection(Time.now());                  // Keep us from looping here
-        sysStatus.set_resetCount(0);                                 // Reset so we don't do this too often        return 1;      
-        resolutionCode = 1;                                        // This will generate a report
-      }
-      resolutionCode = 3;                                         // This will generate a hard reset
-      break;
-
-    case 14:                                                       // This is an out of memory error
-      resolutionCode = 2;                                         // This will generate a soft reset
-      break;
-
-    case 15:                                                       // This is a modem or cellular power down error - need to power cycle to clear
-      resolutionCode = 3;                                         // This will generate a hard reset
-      break;
-
-    case 30:                                                       // We connected to cellular but not to Particle
-      resolutionCode = 2;                                         // This will generate a soft reset
-      break;
-
-    case 31:                                                       // Device failed to connect - bailing for this hour or resetting depending
-      if (Time.now() - sysStatus.get_lastConnection() > 2 * 3600L) {     // If we fail to connect for a couple hours in a row, let's power cycle the device
-        Log.info("Device has failed to connect for 2+ hours - resetting");
-        sysStatus.set_lastConnection(Time.now());                  // Make sure we don't do this very often
-        resolutionCode = 3;                                         // This will generate a hard reset
-      }
-      else {
-        Log.info("Failed to connect - try again next hour");
-        resolutionCode = 0;                                         // Default - no action will be taken
-      }
-      break;
-
-    case 32:                                                       // We are still trying to connect but need to reset first as it is not happening quickly enough
-      resolutionCode = 2;                                         // This will generate a soft reset
-      break;
-
-    case 40:                                                       // This is for failed webhook responses over three hours
-      if (Time.now() - sysStatus.get_lastHookResponse() > 3 * 3600L) {      // Failed to get a webhook response for over three hours
-        resolutionCode = 2;                                         // This will generate a soft reset
-      }
-      resolutionCode = 0;                                         // Default - no action will be taken
-      Log.info("Failed to get Webhook response - try again next hour");
-      break;
-
-    default:                                                       // Make sure that, no matter what - we do not get stuck here
-      resolutionCode = 0;                                         // Default - no action will be taken
-      break;
-  }
+  if (resolutionCode >= ALERT_SOFT_RESET) alertStatus.flush(true); // Make sure the history is saved before we reset
   current.set_alertCode(0);                                         // Need to reset - Alert resolved
   return resolutionCode;
-} 
-
-
+}
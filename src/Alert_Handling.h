@@ -3,7 +3,7 @@
  * @author Chip McClelland (chip@seeinisghts.com)
  * @brief This function will take alert codes and generate the appropriate response
  * 
- * @version 0.3
+ * @version 0.4
  * @date 2022-08-27
  * 
  */
@@ -34,6 +34,7 @@
 #define __ALERT_HANDLING_H
 
 #include "Particle.h"
+#include <atomic>
 
 
 /**
@@ -69,12 +70,86 @@ public:
     void loop();
 
     /**
-     * @brief Looks at the current alert code and generates the right response
+     * @brief Resolution actions - ordered by severity so the most disruptive action for a set of alerts wins
      * 
-     * @details Alert handling may require differnt results
+     */
+    enum AlertAction : uint8_t {
+        ALERT_NO_ACTION = 0,                             // Log it and carry on
+        ALERT_REPORT = 1,                                // Connect and report
+        ALERT_SOFT_RESET = 2,                            // System.reset()
+        ALERT_POWER_CYCLE = 3                            // AB1805 deep power down
+    };
+
+    /**
+     * @brief Alert severity - determines whether the alert is published and which pending alert is reported
+     * 
+     */
+    enum AlertSeverity : uint8_t {
+        ALERT_INFO = 0,                                  // Logged only
+        ALERT_WARNING = 1,                               // Published to Ubidots
+        ALERT_CRITICAL = 2                               // Published to Ubidots - takes precedence in the hourly report
+    };
+
+    static const uint8_t MAX_LADDER_STEPS = 4;           // Longest escalation ladder
+    static const uint8_t MAX_ALERT_POLICIES = 16;        // Size of the history arrays in FRAM - one bit each in the pending mask
+
+    /**
+     * @brief One row of the alert policy table
+     * 
+     * @details Each time an alert is resolved within escalationWindow seconds of its last occurrence the ladder
+     * moves up a step.  An alert that recurs within minInterval seconds is counted but takes no action.  Once a
+     * reset or power cycle is taken the ladder starts over and the next occurrence is treated as the first.
      * 
      */
-    int alertResolution();                               // See if it is safe to charge based on the temperature
+    struct AlertPolicy {
+        uint8_t code;                                    // Alert code (see list above)
+        AlertSeverity severity;
+        uint32_t minInterval;                            // Rate limit - seconds
+        uint32_t escalationWindow;                       // Seconds before the ladder resets to the first step
+        uint8_t ladderSteps;                             // Number of valid entries in ladder
+        AlertAction ladder[MAX_LADDER_STEPS];            // Action taken at each escalation step
+        void (*onResolve)();                             // Optional housekeeping when the alert is resolved
+    };
+
+    /**
+     * @brief Raises an alert - multiple alerts can be pending at once
+     * 
+     * @details Sets the pending bit for the code and updates the reported alert code in current to the most
+     * severe pending alert.  Safe to call from the system thread (Particle function).
+     * 
+     * @param code Alert code from the list above - unknown codes are logged and ignored
+     */
+    void raiseAlert(uint8_t code);
+
+    /**
+     * @brief Are there any alerts waiting to be resolved
+     * 
+     */
+    bool alertsPending() const;
+
+    /**
+     * @brief Is this alert raised and waiting to be resolved
+     * 
+     */
+    bool isPending(uint8_t code) const;
+
+    /**
+     * @brief The condition behind an alert has cleared (connected, got a webhook response) so restart its ladder
+     * 
+     * @details Also forgets the last occurrence so the next one takes the first step of the ladder
+     * 
+     * @param code Alert code from the list above
+     */
+    void clearEscalation(uint8_t code);
+
+    /**
+     * @brief Resolves every pending alert against the policy table and returns the action to take
+     * 
+     * @details Occurrence counts, last occurrence and escalation step are kept per alert code in FRAM
+     * 
+     * @returns The most severe AlertAction across all pending alerts
+     */
+    int alertResolution();
 
 protected:
     /**
@@ -106,5 +181,14 @@ protected:
      */
     static Alert_Handling *_instance;
 
+    /**
+     * @brief Looks up the policy table index for an alert code
+     * 
+     * @returns The index or -1 if there is no policy for this code
+     */
+    int policyIndex(uint8_t code) const;
+
+    std::atomic<uint32_t> pendingAlerts;                 // One bit per policy table row
+
 };
 #endif  /* __Alert_Handling_H */
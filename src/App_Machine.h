@@ -0,0 +1,79 @@
+/*
+ * @file App_Machine.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief The application's state machine - events, context and the state and transition tables.  The handlers
+ * are defined in the main .cpp file.  No Particle dependencies, so tools/host/test_state_machine.cpp builds these
+ * same tables against its own handlers.
+ *
+ * @version 0.1
+ * @date 2023-06-10
+ *
+ */
+
+#ifndef __APP_MACHINE_H
+#define __APP_MACHINE_H
+
+#include <stdint.h>
+#include "App_States.h"
+#include "State_Machine.h"
+
+enum AppEventSource : uint8_t { USER_SWITCH_EVENT, SENSOR_EVENT, ALERT_EVENT };
+
+// What an interrupt saw - queued by the ISRs so edges between passes of the main loop are not merged or lost
+struct AppEvent {
+  uint8_t source;                                   // AppEventSource
+  uint32_t micros;                                  // When the edge happened
+  uint8_t pinState;                                 // Level of the pin as the ISR read it
+};
+
+const unsigned long stayAwakeLong = 90000UL;        // In lowPowerMode, how long to stay awake every hour
+
+// Everything the state handlers need to keep between passes of the main loop
+struct AppContext {
+  unsigned long stayAwakeTimeStamp = 0UL;           // Timestamps for our timing variables..
+  unsigned long stayAwake = stayAwakeLong;          // Stores the time we need to wait before napping
+  unsigned long webhookTimeStamp = 0UL;             // When we started waiting for the webhook response
+  unsigned long connectionStartTimeStamp = 0UL;     // Time in Millis that helps us know how long it took to connect
+  uint8_t connectingFrom = INITIALIZATION_STATE;    // Keep track for where to go next (depends on whether we were called from Reporting)
+  bool cloudConnecting = false;                     // Registered on cellular and Particle.connect() called
+  int alertResponse = 0;                            // What Alert_Handling wants us to do in the Error state
+  unsigned long resetTimer = 0UL;                   // When we entered the Error state
+  uint32_t lastSwitchMicros = 0;                    // Last user switch press we acted on
+  uint32_t lastLidMicros = 0;                       // Last sensor interrupt we counted as lid activity
+  bool lidActivitySeen = false;                     // lastLidMicros is valid
+};
+
+// State handlers
+void errorEntry(AppContext &ctx);
+void errorTick(AppContext &ctx);
+void idleTick(AppContext &ctx);
+void sleepingTick(AppContext &ctx);
+void connectingEntry(AppContext &ctx);
+void connectingTick(AppContext &ctx);
+void reportingTick(AppContext &ctx);
+void respWaitEntry(AppContext &ctx);
+void respWaitTick(AppContext &ctx);
+bool inputEvent(AppContext &ctx, const AppEvent &event);
+inline uint8_t appEventKey(const AppEvent &event) { return event.source; }
+
+typedef StateMachine<AppContext, AppEvent, STATE_COUNT, 1> AppStateMachine;
+
+// Indexed by State - parent, entry, tick, exit, event
+const AppStateMachine::StateDef appStates[STATE_COUNT] = {
+  {AppStateMachine::NO_PARENT, nullptr, nullptr, nullptr, inputEvent},                  // INITIALIZATION_STATE
+  {AppStateMachine::NO_PARENT, errorEntry, errorTick, nullptr, inputEvent},             // ERROR_STATE
+  {AWAKE_STATE, nullptr, idleTick, nullptr, nullptr},                                   // IDLE_STATE
+  {AppStateMachine::NO_PARENT, nullptr, sleepingTick, nullptr, inputEvent},             // SLEEPING_STATE
+  {AppStateMachine::NO_PARENT, nullptr, nullptr, nullptr, inputEvent},                  // NAPPING_STATE
+  {AWAKE_STATE, connectingEntry, connectingTick, nullptr, nullptr},                     // CONNECTING_STATE
+  {AWAKE_STATE, nullptr, reportingTick, nullptr, nullptr},                              // REPORTING_STATE
+  {AWAKE_STATE, respWaitEntry, respWaitTick, nullptr, nullptr},                         // RESP_WAIT_STATE
+  {AppStateMachine::NO_PARENT, nullptr, nullptr, nullptr, inputEvent}                   // AWAKE_STATE
+};
+
+// Event driven transitions - source, event, target
+const AppStateMachine::Transition appTransitions[1] = {
+  {AppStateMachine::ANY_STATE, ALERT_EVENT, ERROR_STATE}                                // Any pending alert sends us to the Error state
+};
+
+#endif  /* __APP_MACHINE_H */
@@ -0,0 +1,23 @@
+/*
+ * @file App_States.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief The application's state numbers - shared by the state machine tables in the main .cpp file and the
+ * per state statistics kept in FRAM
+ *
+ * @version 0.1
+ * @date 2023-06-03
+ *
+ */
+
+#ifndef __APP_STATES_H
+#define __APP_STATES_H
+
+#include <stdint.h>
+
+// AWAKE_STATE is the parent of the states where we stay up and may be connected.  Parent (composite) states go
+// after the leaf states - transitions are only made to leaves, so only leaves are counted in FRAM.
+enum State { INITIALIZATION_STATE, ERROR_STATE, IDLE_STATE, SLEEPING_STATE, NAPPING_STATE, CONNECTING_STATE, REPORTING_STATE, RESP_WAIT_STATE, AWAKE_STATE, STATE_COUNT};
+
+const uint8_t LEAF_STATE_COUNT = AWAKE_STATE;          // States a transition can start or end in
+
+#endif  /* __APP_STATES_H */
@@ -0,0 +1,128 @@
+//Particle Functions
+#include "Particle.h"
+#include "MyPersistentData.h"
+#include "take_measurements.h"
+#include "Measure_Trash.h"
+#include "Particle_Functions.h"
+#include "JsonParserGeneratorRK.h"
+#include "Binary_Log.h"
+#include "Benchmark.h"
+
+Benchmark *Benchmark::_instance;
+
+namespace {
+  // A typical console command - only parsed, running it would change the device
+  const char * const benchCommand = "{\"cmd\":[{\"var\":\"soft\",\"fn\":\"restart\"},{\"var\":\"21\",\"fn\":\"close\"}]}";
+
+  // A scratch reading that is never committed - an empty can, so no emptying is seen and nothing is learned
+  Measurement scratchReading() {
+    Measurement reading = current.measurement();
+    reading.percentFull = 0.0;
+    return reading;
+  }
+
+  void benchMeasureHeight() {
+    Measurement reading = scratchReading();
+    Measure_Trash::instance().measureHeight(reading);
+  }
+
+  void benchReadSensors() {
+    Measurement reading = scratchReading();                         // takeMeasurements() without the commit and daily stats
+    Take_Measurements::instance().readSensors(reading);
+  }
+
+  void benchPayload() {
+    char data[256];
+    Particle_Functions::instance().buildEventPayload(data, sizeof(data));
+  }
+
+  void benchCommandParse() {
+    char variable[64];
+    char function[16];
+    JsonParserStatic<1024, 80> jp;                                // Same parser jsonFunctionParser() uses
+
+    jp.addString(benchCommand);
+    if (!jp.parse()) return;
+    const JsonParserGeneratorRK::jsmntok_t *cmdArrayContainer;
+    jp.getValueTokenByKey(jp.getOuterObject(), "cmd", cmdArrayContainer);
+    for (int i = 0; i < 10; i++) {
+      const JsonParserGeneratorRK::jsmntok_t *cmdObjectContainer = jp.getTokenByIndex(cmdArrayContainer, i);
+      if (cmdObjectContainer == NULL) break;
+      jp.getValueByKey(cmdObjectContainer, "var", variable, sizeof(variable));
+      jp.getValueByKey(cmdObjectContainer, "fn", function, sizeof(function));
+    }
+  }
+
+  void benchCurrentSave() {
+    current.save();
+  }
+
+  void benchSysStatusSave() {
+    sysStatus.save();
+  }
+
+  struct BenchStep {
+    const char *name;
+    void (*fn)();
+    bool slow;                                                    // Talks to the sensors - capped at a few iterations
+  };
+
+  const BenchStep benchSteps[] = {
+    {"measureHeight", benchMeasureHeight, true},
+    {"readSensors", benchReadSensors, true},
+    {"sendEvent payload", benchPayload, false},
+    {"command parse", benchCommandParse, false},
+    {"current save", benchCurrentSave, false},
+    {"sysStatus save", benchSysStatusSave, false},
+  };
+
+  const uint16_t slowIterations = 5;
+}
+
+// [static]
+Benchmark &Benchmark::instance() {
+  if (!_instance) {
+      _instance = new Benchmark();
+  }
+  return *_instance;
+}
+
+Benchmark::Benchmark() {
+}
+
+Benchmark::~Benchmark() {
+}
+
+void Benchmark::loop() {
+  uint16_t iterations = requestedIterations;
+  if (iterations == 0) return;
+  requestedIterations = 0;
+  run(iterations);
+}
+
+void Benchmark::requestRun(uint16_t iterations) {
+  requestedIterations = constrain(iterations, 1, MAX_ITERATIONS);
+}
+
+void Benchmark::run(uint16_t iterations) {
+  Log.info("Benchmark - %u iterations (%u for sensor steps)", iterations, min(iterations, slowIterations));
+  Log.info("%-20s %6s %10s %10s %10s", "step", "runs", "min us", "avg us", "max us");
+  Binary_Log::instance().muteCurrentThread(true);                 // Thousands of measurement records would empty the ring
+
+  for (const BenchStep &step : benchSteps) {
+    uint16_t runs = step.slow ? min(iterations, slowIterations) : iterations;
+    unsigned long minUs = 0xFFFFFFFFUL, maxUs = 0, totalUs = 0;
+
+    for (uint16_t i = 0; i < runs; i++) {
+      unsigned long start = micros();
+      step.fn();
+      unsigned long elapsed = micros() - start;
+      totalUs += elapsed;
+      if (elapsed < minUs) minUs = elapsed;
+      if (elapsed > maxUs) maxUs = elapsed;
+      Particle.process();                                         // Some steps are long - keep the cloud connection serviced
+    }
+    Log.info("%-20s %6u %10lu %10lu %10lu", step.name, runs, minUs, totalUs / runs, maxUs);
+  }
+  Binary_Log::instance().muteCurrentThread(false);
+}
@@ -0,0 +1,91 @@
+/*
+ * @file Benchmark.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Times the measurement and reporting pipeline with micros() and prints a summary table - started with
+ * the "bench" command so performance changes can be checked against numbers
+ *
+ * @version 0.1
+ * @date 2023-04-01
+ *
+ */
+
+#ifndef __BENCHMARK_H
+#define __BENCHMARK_H
+
+#include "Particle.h"
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * From global application loop you must call:
+ * Benchmark::instance().loop();
+ *
+ * Start a run (safe from the system thread) with:
+ * Benchmark::instance().requestRun(iterations);
+ */
+class Benchmark {
+public:
+    static const uint16_t MAX_ITERATIONS = 100;         // Sensor reads take ~1/2 second each
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use Benchmark::instance() to instantiate the singleton.
+     */
+    static Benchmark &instance();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     *
+     * @details Runs the benchmark here on the application thread if one has been requested - this blocks
+     * for as long as the run takes
+     *
+     */
+    void loop();
+
+    /**
+     * @brief Asks for a benchmark run on the next pass of the main loop
+     *
+     * @param iterations Times to run each step - constrained to 1 to MAX_ITERATIONS
+     */
+    void requestRun(uint16_t iterations);
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use Benchmark::instance() to instantiate the singleton.
+     */
+    Benchmark();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~Benchmark();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Benchmark(const Benchmark&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Benchmark& operator=(const Benchmark&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static Benchmark *_instance;
+
+    /**
+     * @brief Runs every step and logs the table
+     *
+     */
+    void run(uint16_t iterations);
+
+    volatile uint16_t requestedIterations = 0;          // Set from the system thread, 0 = nothing to do
+};
+#endif  /* __BENCHMARK_H */
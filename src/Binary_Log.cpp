@@ -0,0 +1,257 @@
+//Particle Functions
+#include "Particle.h"
+#include "Binary_Log.h"
+#include "MyPersistentData.h"
+#include "PublishQueuePosixRK.h"
+
+Binary_Log *Binary_Log::_instance;
+
+namespace {
+  const char * const parkNames[] = {"closed", "open"};
+  const char * const lidNames[] = {"unknown", "on its side", "on its side", "on its side", "on its side", "right side up", "upside down"};
+  const char * const tofStatusNames[] = {"ok", "not valid", "not ready"};
+  const char * const sampleNames[] = {"no sample", "ok"};
+  const char * const connectNames[] = {"connected", "failed with cellular", "failed without cellular"};
+
+  struct MessageFormat {
+    const char *format;                                           // printf style - %s arguments are indices into strings
+    const char * const *strings;
+    uint8_t stringCount;
+  };
+
+  // Indexed by Binary_Log::MessageId - this table is the decoder so only add to the end
+  const MessageFormat messageFormats[] = {
+    {"From %s to %s", stateNames, 8},
+    {"From %s to %s with invalid time", stateNames, 8},
+    {"Local hour is %i and the park is %s", parkNames, 2},
+    {"Data ready and distance is %i\"", nullptr, 0},
+    {"Data ready but not valid", nullptr, 0},
+    {"TOF Data not ready", nullptr, 0},
+    {"Lid %s with x:%d, y:%d, z:%d", lidNames, 7},
+    {"Accelerometer had no sample", nullptr, 0},
+    {"Not all sensors read successfully", nullptr, 0},
+    {"Trash height is %i\" and can is %4.1f%% full - emptied %i", nullptr, 0},
+    {"Connected in %i secs", nullptr, 0},
+    {"Time to wake up with %li free memory", nullptr, 0},
+    {"Battery voltage is %4.2f", nullptr, 0},
+    {"Internal Temp: %4.2fC", nullptr, 0},
+    {"Trace TOF %s %i mm", tofStatusNames, 3},
+    {"Trace accel %s x:%d, y:%d, z:%d", sampleNames, 2},
+    {"Trace VCell %5.3fV", nullptr, 0},
+    {"Trace connect %s after %i secs", connectNames, 3},
+    {"Trace webhook response %i after %lu ms", nullptr, 0},
+    {"Connect failed %i times in a row - next try in %i min", nullptr, 0},
+    {"Not connecting - %i min of backoff left", nullptr, 0},
+    {"Lid activity %u today (%lu us since the last)", nullptr, 0},
+    {"Event queue full - %u interrupts dropped", nullptr, 0},
+  };
+  static_assert(sizeof(messageFormats) / sizeof(messageFormats[0]) == Binary_Log::MSG_COUNT, "Binary_Log format table does not match MessageId");
+}
+
+// [static]
+Binary_Log &Binary_Log::instance() {
+  if (!_instance) {
+      _instance = new Binary_Log();
+  }
+  return *_instance;
+}
+
+Binary_Log::Binary_Log() {
+  os_mutex_create(&mutex);
+}
+
+Binary_Log::~Binary_Log() {
+}
+
+void Binary_Log::setup() {
+  logStatus.setup();
+  tracing = logStatus.get_traceEnabled();
+}
+
+void Binary_Log::setTracing(bool enable) {
+  tracing = enable;
+  logStatus.set_traceEnabled(enable);
+}
+
+void Binary_Log::loop() {
+  char line[128];
+  Record rec;
+
+  commitToFram();
+  servicePull();
+  logStatus.loop();
+
+  if (!Serial.isConnected()) return;                              // Nobody listening - leave the records in binary form
+
+  while (takeRecord(tail, rec)) {
+    format(rec, line, sizeof(line));
+    Log.info("%s", line);
+  }
+}
+
+bool Binary_Log::takeRecord(uint16_t &cursor, Record &rec) {
+  bool found = false;
+
+  WITH_LOCK(*this) {
+    if (cursor != head) {
+      if ((uint16_t)(head - cursor) > RING_SIZE) cursor = head - RING_SIZE;   // Overwritten while we were not looking
+      rec = ring[cursor % RING_SIZE];
+      cursor++;
+      found = true;
+    }
+  }
+  return found;
+}
+
+size_t Binary_Log::framRingRecords() const {
+  return (fram.length() - FRAM_RING_OFFSET) / sizeof(Record);
+}
+
+void Binary_Log::commitToFram() {
+  Record rec;
+
+  while (takeRecord(committed, rec)) {
+    uint32_t sequence = logStatus.get_nextSequence();
+    rec.sequence = (uint16_t)sequence;                            // In FRAM the sequence is the position in the persistent log
+    fram.writeData(FRAM_RING_OFFSET + (sequence % framRingRecords()) * sizeof(Record), (const uint8_t *)&rec, sizeof(Record));
+    logStatus.set_nextSequence(sequence + 1);
+  }
+}
+
+uint32_t Binary_Log::requestPull(long start) {
+  uint32_t next = logStatus.get_nextSequence();
+  uint32_t oldest = (next > framRingRecords()) ? next - framRingRecords() : 0;
+  uint32_t cursor;
+
+  if (start >= 0) cursor = (uint32_t)start;
+  else if (logStatus.get_pullEnd() != 0) cursor = logStatus.get_pullCursor();   // Resume where we left off
+  else cursor = oldest;
+  if (cursor < oldest) cursor = oldest;
+
+  logStatus.set_pullCursor(cursor);
+  logStatus.set_pullEnd(next);
+  return cursor;
+}
+
+void Binary_Log::servicePull() {
+  char data[PULL_CHUNK_RECORDS * sizeof(Record) * 2 + 64];       // Hex encoded records plus the JSON wrapper
+  Record rec;
+
+  uint32_t end = logStatus.get_pullEnd();
+  if (end == 0 || !Particle.connected()) return;
+  if (millis() - lastPullPublish < 1000) return;
+  if (PublishQueuePosix::instance().getNumEvents() > 0) return;  // Backpressure - measurements and alerts go out first
+
+  uint32_t next = logStatus.get_nextSequence();
+  uint32_t oldest = (next > framRingRecords()) ? next - framRingRecords() : 0;
+  uint32_t cursor = logStatus.get_pullCursor();
+  if (cursor < oldest) cursor = oldest;                           // These were overwritten while we waited to connect
+
+  if (cursor >= end) {
+    snprintf(data, sizeof(data), "{\"cursor\":%lu,\"end\":%lu,\"records\":\"\"}", (unsigned long)cursor, (unsigned long)end);
+    PublishQueuePosix::instance().publish("log", data, PRIVATE | WITH_ACK);
+    logStatus.set_pullCursor(cursor);
+    logStatus.set_pullEnd(0);                                     // An empty chunk marks the end of the pull
+    return;
+  }
+
+  size_t len = snprintf(data, sizeof(data), "{\"cursor\":%lu,\"end\":%lu,\"records\":\"", (unsigned long)cursor, (unsigned long)end);
+  uint8_t count = 0;
+  for (; cursor < end && count < PULL_CHUNK_RECORDS; cursor++, count++) {
+    fram.readData(FRAM_RING_OFFSET + (cursor % framRingRecords()) * sizeof(Record), (uint8_t *)&rec, sizeof(Record));
+    const uint8_t *p = (const uint8_t *)&rec;
+    for (size_t i = 0; i < sizeof(Record); i++) {
+      len += snprintf(&data[len], sizeof(data) - len, "%02x", p[i]);
+    }
+  }
+  snprintf(&data[len], sizeof(data) - len, "\"}");
+
+  PublishQueuePosix::instance().publish("log", data, PRIVATE | WITH_ACK);
+  logStatus.set_pullCursor(cursor);
+  lastPullPublish = millis();
+}
+
+void Binary_Log::muteCurrentThread(bool mute) {
+  WITH_LOCK(*this) {
+    mutedThread = mute ? os_thread_current(nullptr) : nullptr;
+  }
+}
+
+void Binary_Log::write(MessageId id, const uint32_t *args, uint8_t argCount) {
+  WITH_LOCK(*this) {
+    if (mutedThread != nullptr && mutedThread == os_thread_current(nullptr)) return;
+    Record &rec = ring[head % RING_SIZE];
+    rec.timestamp = (uint32_t)Time.now();
+    rec.id = id;
+    rec.argCount = argCount;
+    rec.sequence = head;
+    memset(rec.args, 0, sizeof(rec.args));
+    memcpy(rec.args, args, argCount * sizeof(uint32_t));
+    head++;
+  }
+}
+
+size_t Binary_Log::format(const Record &rec, char *buf, size_t bufLen) const {
+  char spec[12];                                                  // One conversion specification, e.g. %4.2f
+  size_t len = 0;
+  uint8_t argIndex = 0;
+
+  if (bufLen == 0) return 0;
+  buf[0] = '\0';
+
+  if (rec.id >= MSG_COUNT) {
+    return snprintf(buf, bufLen, "Unknown message %u", rec.id);
+  }
+
+  const MessageFormat &msg = messageFormats[rec.id];
+  for (const char *p = msg.format; *p && len < bufLen - 1; p++) {
+    if (*p != '%') {
+      buf[len++] = *p;
+      continue;
+    }
+    if (*(p+1) == '%') {                                          // Literal percent sign
+      buf[len++] = '%';
+      p++;
+      continue;
+    }
+
+    // Copy the specification up to and including the conversion character
+    size_t specLen = 0;
+    while (*p && specLen < sizeof(spec) - 1) {
+      spec[specLen++] = *p;
+      if (specLen > 1 && strchr("diuxXcsfeEgG", *p)) break;
+      p++;
+    }
+    spec[specLen] = '\0';
+    if (!*p) break;
+
+    uint32_t arg = (argIndex < rec.argCount) ? rec.args[argIndex] : 0;
+    argIndex++;
+    int written;
+    char conversion = *p;
+
+    if (conversion == 's') {
+      const char *str = (msg.strings && arg < msg.stringCount) ? msg.strings[arg] : "?";
+      written = snprintf(&buf[len], bufLen - len, spec, str);
+    }
+    else if (strchr("feEgG", conversion)) {
+      float value;
+      memcpy(&value, &arg, sizeof(value));
+      written = snprintf(&buf[len], bufLen - len, spec, (double)value);
+    }
+    else if (strchr("uxX", conversion)) {                         // Unsigned - values of 2^31 and up must not go negative
+      if (strchr(spec, 'l')) written = snprintf(&buf[len], bufLen - len, spec, (unsigned long)arg);
+      else written = snprintf(&buf[len], bufLen - len, spec, (unsigned int)arg);
+    }
+    else if (strchr(spec, 'l')) {
+      written = snprintf(&buf[len], bufLen - len, spec, (long)(int32_t)arg);
+    }
+    else {
+      written = snprintf(&buf[len], bufLen - len, spec, (int)(int32_t)arg);
+    }
+    if (written < 0) break;
+    len += ((size_t)written < bufLen - len) ? (size_t)written : bufLen - len - 1;
+  }
+  buf[len] = '\0';
+  return len;
+}
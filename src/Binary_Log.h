@@ -0,0 +1,240 @@
+/*
+ * @file Binary_Log.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Deferred-format logging - call sites record a message id and raw arguments, formatting only happens
+ * when someone is listening on Serial or on the host (tools/decode_log.py).  Records are kept in a FRAM ring
+ * that can be pulled back over the Commands function.
+ *
+ * @version 0.2
+ * @date 2023-03-04
+ *
+ */
+
+#ifndef __BINARY_LOG_H
+#define __BINARY_LOG_H
+
+#include "Particle.h"
+
+extern const char * const stateNames[];             // Defined with the state machine in the main .cpp file
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * From global application setup you must call:
+ * Binary_Log::instance().setup();
+ *
+ * From global application loop you must call:
+ * Binary_Log::instance().loop();
+ *
+ * Record messages with:
+ * Binary_Log::instance().record(Binary_Log::MSG_CONNECTED, seconds);
+ *
+ * Record raw sensor and connectivity inputs (only kept when tracing is on) with:
+ * Binary_Log::instance().trace(Binary_Log::MSG_TRACE_VCELL, volts);
+ */
+class Binary_Log {
+public:
+    /**
+     * @brief Message ids - the index into the format table in Binary_Log.cpp
+     *
+     * @details Only add to the end of this list - the ids are what is stored so the format table is the decoder
+     *
+     */
+    enum MessageId : uint8_t {
+        MSG_STATE_TRANSITION = 0,                       // From %s to %s (state names)
+        MSG_STATE_TRANSITION_NO_TIME,                   // From %s to %s with invalid time
+        MSG_PARK_HOURS,                                 // Local hour is %i and the park is %s
+        MSG_TOF_DISTANCE,                               // Data ready and distance is %i"
+        MSG_TOF_NOT_VALID,                              // Data ready but not valid
+        MSG_TOF_NOT_READY,                              // TOF Data not ready
+        MSG_LID_POSITION,                               // Lid %s with x:%d, y:%d, z:%d
+        MSG_ACCEL_NO_SAMPLE,                            // Accelerometer had no sample
+        MSG_SENSORS_FAILED,                             // Not all sensors read successfully
+        MSG_TRASH_SUMMARY,                              // Trash height is %i" and can is %4.1f%% full - emptied %i
+        MSG_CONNECTED,                                  // Connected in %i secs
+        MSG_WAKE,                                       // Time to wake up with %li free memory
+        MSG_BATTERY,                                    // Battery voltage is %4.2f
+        MSG_INTERNAL_TEMP,                              // Internal Temp: %4.2fC
+        MSG_TRACE_TOF,                                  // Trace TOF %s %i mm (status, raw distance)
+        MSG_TRACE_ACCEL,                                // Trace accel %s x:%d, y:%d, z:%d
+        MSG_TRACE_VCELL,                                // Trace VCell %5.3fV
+        MSG_TRACE_CONNECT,                              // Trace connect %s after %i secs
+        MSG_TRACE_WEBHOOK,                              // Trace webhook response %i after %lu ms (0 = timed out)
+        MSG_CONNECT_BACKOFF,                            // Connect failed %i times in a row - next try in %i min
+        MSG_CONNECT_SKIPPED,                            // Not connecting - %i min of backoff left
+        MSG_LID_ACTIVITY,                               // Lid activity %u today (%lu us since the last)
+        MSG_EVENTS_DROPPED,                             // Event queue full - %u interrupts dropped
+        MSG_COUNT                                       // Keep last
+    };
+
+    static const uint8_t MAX_ARGS = 4;                  // Arguments per record
+    static const uint8_t RING_SIZE = 32;                // Records held in RAM
+    static const size_t FRAM_RING_OFFSET = 4096;        // Records are kept from here to the end of the FRAM
+    static const uint8_t PULL_CHUNK_RECORDS = 16;       // Records per log pull publish - 16 x 48 hex characters
+
+    /**
+     * @brief A log record - 24 bytes, stored and transferred as-is
+     *
+     */
+    struct Record {
+        uint32_t timestamp;                             // Time.now() when recorded
+        uint8_t id;                                     // MessageId
+        uint8_t argCount;
+        uint16_t sequence;                              // Wraps - lets a decoder spot gaps
+        uint32_t args[MAX_ARGS];                        // Integers as-is, floats as IEEE-754 bits
+    };
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use Binary_Log::instance() to instantiate the singleton.
+     */
+    static Binary_Log &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup() after the FRAM is up
+     *
+     * You typically use Binary_Log::instance().setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     *
+     * @details Commits new records to the FRAM ring, sends the next log pull chunk if the publish queue is idle
+     * and formats waiting records, but only if Serial is connected
+     *
+     */
+    void loop();
+
+    /**
+     * @brief Starts (or resumes) sending the FRAM log ring to the cloud as "log" events
+     *
+     * @details Safe to call from the system thread.  The pull covers every record written up to now and
+     * survives resets and lost connections - the cursor is kept in FRAM.
+     *
+     * @param start Sequence number to start from or -1 to resume from the saved cursor
+     *
+     * @returns The sequence number the pull will start from
+     */
+    uint32_t requestPull(long start);
+
+    /**
+     * @brief Record a message - no formatting is done here
+     *
+     * @param id The MessageId
+     * @param args Up to MAX_ARGS integer, bool or floating point arguments - %s arguments are indices into the message's string table
+     */
+    template<typename... Args>
+    void record(MessageId id, Args... args) {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "Too many arguments for a Binary_Log record");
+        uint32_t packed[sizeof...(Args) + 1] = { pack(args)..., 0 };
+        write(id, packed, sizeof...(Args));
+    }
+
+    /**
+     * @brief Record a trace message - the raw inputs the firmware acted on, so a field problem can be reproduced
+     *
+     * @details Does nothing unless tracing has been turned on with the "trace" command as traces fill the ring quickly
+     *
+     */
+    template<typename... Args>
+    void trace(MessageId id, Args... args) {
+        if (tracing) record(id, args...);
+    }
+
+    /**
+     * @brief Turns tracing on or off - the setting is kept in FRAM so it survives resets
+     *
+     */
+    void setTracing(bool enable);
+
+    bool isTracing() const { return tracing; }
+
+    /**
+     * @brief Drops records made from the calling thread until called again with false
+     *
+     * @details The benchmark runs the measurement code many times - its records would push real ones out of the
+     * ring.  Records from other threads are still kept.
+     *
+     */
+    void muteCurrentThread(bool mute);
+
+    /**
+     * @brief Formats a record into a caller supplied buffer - no heap allocation
+     *
+     * @returns The number of characters written (not including the null)
+     */
+    size_t format(const Record &rec, char *buf, size_t bufLen) const;
+
+    void lock() { os_mutex_lock(mutex); };
+
+    void unlock() { os_mutex_unlock(mutex); };
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use Binary_Log::instance() to instantiate the singleton.
+     */
+    Binary_Log();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~Binary_Log();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Binary_Log(const Binary_Log&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Binary_Log& operator=(const Binary_Log&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static Binary_Log *_instance;
+
+    // Argument packing - everything is stored as a 32 bit word
+    static uint32_t pack(int value) { return (uint32_t)value; }
+    static uint32_t pack(unsigned int value) { return value; }
+    static uint32_t pack(long value) { return (uint32_t)value; }
+    static uint32_t pack(unsigned long value) { return (uint32_t)value; }
+    static uint32_t pack(bool value) { return value ? 1 : 0; }
+    static uint32_t pack(double value) { return pack((float)value); }
+    static uint32_t pack(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    void write(MessageId id, const uint32_t *args, uint8_t argCount);
+
+    /**
+     * @brief Copies the next record after cursor out of the RAM ring, skipping any that were overwritten
+     *
+     * @returns false if there are no records after cursor
+     */
+    bool takeRecord(uint16_t &cursor, Record &rec);
+
+    void commitToFram();                                // Writes records from RAM to the FRAM ring
+    void servicePull();                                 // Publishes the next chunk of a log pull
+
+    size_t framRingRecords() const;                     // FRAM ring capacity in records
+
+    os_mutex_t mutex;                                   // Records come from the application and system threads
+    Record ring[RING_SIZE];
+    uint16_t head = 0;                                  // Total records written (mod 2^16)
+    uint16_t tail = 0;                                  // Total records formatted
+    uint16_t committed = 0;                             // Total records written to FRAM
+    unsigned long lastPullPublish = 0;                  // Keeps log pull to one publish a second
+    bool tracing = false;                               // Cached from logStatus
+    os_thread_t mutedThread = nullptr;                  // Records from this thread are dropped - see muteCurrentThread()
+};
+#endif  /* __BINARY_LOG_H */
@@ -0,0 +1,113 @@
+//Particle Functions
+#include "Particle.h"
+#include "MyPersistentData.h"
+#include "PublishQueuePosixRK.h"
+#include "LocalTimeRK.h"
+#include "Daily_Stats.h"
+
+Daily_Stats *Daily_Stats::_instance;
+
+namespace {
+  const time_t maxSampleGap = 5 * 3600;                           // Longest a level is held - the 4 hour autonomous heartbeat plus slack
+  const uint8_t lidRightsideUp = 5;                               // See Measurement::lidPosition
+
+  // Local date as YYYYMMDD - the day a report covers is the park's day, not UTC's
+  uint32_t localDay(time_t time) {
+    LocalTimeConvert local;                                       // Picks up the global timezone on convert()
+    local.withTime(time).convert();
+    LocalTimeYMD ymd = local.getLocalTimeYMD();
+    return (uint32_t)(ymd.getYear() * 10000 + ymd.getMonth() * 100 + ymd.getDay());
+  }
+}
+
+// [static]
+Daily_Stats &Daily_Stats::instance() {
+  if (!_instance) {
+      _instance = new Daily_Stats();
+  }
+  return *_instance;
+}
+
+Daily_Stats::Daily_Stats() {
+}
+
+Daily_Stats::~Daily_Stats() {
+}
+
+void Daily_Stats::setup() {
+  dailyStats.setup();
+}
+
+void Daily_Stats::loop() {
+  dailyStats.loop();
+}
+
+void Daily_Stats::addMeasurement(const Measurement &reading) {
+  if (!Time.isValid()) return;                                    // Cannot tell which day it belongs to
+
+  uint32_t today = localDay(reading.lastMeasureTime);
+  dailyStatsData::Aggregates totals = dailyStats.get_totals();
+  if (totals.day != today) {
+    closeDay(today);
+    totals = dailyStats.get_totals();
+  }
+
+  // The level and lid from the last sample held until this one - the first sample of a day has nothing to credit
+  if (totals.lastSampleTime > 0 && reading.lastMeasureTime > totals.lastSampleTime) {
+    uint32_t interval = (uint32_t)min(reading.lastMeasureTime - totals.lastSampleTime, maxSampleGap);
+    if (totals.lastFill > 75.0) totals.secondsAbove75 += interval;
+    if (totals.lastFill > 90.0) totals.secondsAbove90 += interval;
+    if (totals.lastLidPosition != 0 && totals.lastLidPosition != lidRightsideUp) totals.lidOffSeconds += interval;
+  }
+
+  if (totals.samples == 0 || reading.percentFull < totals.minFill) totals.minFill = reading.percentFull;
+  if (totals.samples == 0 || reading.percentFull > totals.maxFill) totals.maxFill = reading.percentFull;
+  if (totals.samples == 0 || reading.batteryVoltage < totals.minBattery) totals.minBattery = reading.batteryVoltage;
+  totals.sumFill += reading.percentFull;
+  if (totals.samples < 0xFFFF) totals.samples++;
+  if (reading.trashcanEmptied && totals.emptiedCount < 0xFFFF) totals.emptiedCount++;
+
+  totals.lastSampleTime = reading.lastMeasureTime;
+  totals.lastFill = reading.percentFull;
+  totals.lastLidPosition = reading.lidPosition;
+  dailyStats.set_totals(totals);                                  // One lock and one hash for the whole sample
+}
+
+void Daily_Stats::addConnection(uint32_t seconds) {
+  if (!Time.isValid()) return;
+
+  uint32_t today = localDay(Time.now());
+  if (dailyStats.get_totals().day != today) closeDay(today);
+
+  dailyStatsData::Aggregates totals = dailyStats.get_totals();
+  totals.connectSeconds += seconds;
+  dailyStats.set_totals(totals);
+}
+
+void Daily_Stats::dailyReport() {
+  if (!Time.isValid()) return;
+
+  uint32_t today = localDay(Time.now());
+  if (dailyStats.get_totals().day != today) closeDay(today);     // A measurement may already have closed it
+}
+
+void Daily_Stats::closeDay(uint32_t newDay) {
+  char data[256];
+  dailyStatsData::Aggregates totals = dailyStats.get_totals();
+
+  if (totals.samples > 0 || totals.connectSeconds > 0) {
+    float meanFill = (totals.samples > 0) ? totals.sumFill / totals.samples : 0.0;
+    snprintf(data, sizeof(data), "{\"date\":%lu,\"samples\":%u,\"fill\":[%4.1f,%4.1f,%4.1f],\"above75\":%lu,\"above90\":%lu,\"emptied\":%u,\"lidoff\":%lu,\"battery\":%4.2f,\"connect\":%lu,\"timestamp\":%lu000}",
+      (unsigned long)totals.day, totals.samples, totals.minFill, meanFill, totals.maxFill,
+      (unsigned long)((totals.secondsAbove75 + 30) / 60), (unsigned long)((totals.secondsAbove90 + 30) / 60), totals.emptiedCount,
+      (unsigned long)((totals.lidOffSeconds + 30) / 60), totals.minBattery, (unsigned long)totals.connectSeconds, Time.now());
+    PublishQueuePosix::instance().publish("dailyStats", data, PRIVATE | WITH_ACK);
+    Log.info("Daily aggregates for %lu queued", (unsigned long)totals.day);
+  }
+
+  dailyStats.initialize();                                        // Start a new day
+  totals = dailyStats.get_totals();
+  totals.day = newDay;
+  dailyStats.set_totals(totals);
+  dailyStats.flush(true);
+}
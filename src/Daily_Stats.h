@@ -0,0 +1,108 @@
+/*
+ * @file Daily_Stats.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Running daily aggregates kept in FRAM - fill range and mean, time above 75% and 90%, emptied count,
+ * lid off time, lowest battery and time spent connecting - sent as one compact record for the day before
+ *
+ * @version 0.1
+ * @date 2023-05-27
+ *
+ */
+
+#ifndef __DAILY_STATS_H
+#define __DAILY_STATS_H
+
+#include "Particle.h"
+#include "Measurement_Snapshot.h"
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * From global application setup you must call:
+ * Daily_Stats::instance().setup();
+ *
+ * From global application loop you must call:
+ * Daily_Stats::instance().loop();
+ */
+class Daily_Stats {
+public:
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use Daily_Stats::instance() to instantiate the singleton.
+     */
+    static Daily_Stats &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     *
+     * You typically use Daily_Stats::instance().setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     *
+     * You typically use Daily_Stats::instance().loop();
+     */
+    void loop();
+
+    /**
+     * @brief Folds one measurement into today's totals
+     *
+     * @details Called from takeMeasurements() once the reading is committed.  A reading from a later local day
+     * closes out the day before first, so it does not matter whether this or dailyCleanup() sees the new day first.
+     */
+    void addMeasurement(const Measurement &reading);
+
+    /**
+     * @brief Adds the time spent on one connection attempt - made or failed
+     *
+     */
+    void addConnection(uint32_t seconds);
+
+    /**
+     * @brief Queues the totals as a "dailyStats" event and starts a new day - only if they are from an earlier day
+     *
+     * @details Called from dailyCleanup() - the event goes out with the first connection
+     *
+     */
+    void dailyReport();
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use Daily_Stats::instance() to instantiate the singleton.
+     */
+    Daily_Stats();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~Daily_Stats();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Daily_Stats(const Daily_Stats&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Daily_Stats& operator=(const Daily_Stats&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static Daily_Stats *_instance;
+
+    /**
+     * @brief Queues the totals if there are any and clears them for the day given
+     *
+     */
+    void closeDay(uint32_t newDay);
+};
+#endif  /* __DAILY_STATS_H */
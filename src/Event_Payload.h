@@ -0,0 +1,41 @@
+/*
+ * @file Event_Payload.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Formats the Ubidots webhook payload from a measurement and the counters that go with it.  No Particle
+ * dependencies so the host benchmark in tools/host times the same code the device publishes with.
+ *
+ * @version 0.1
+ * @date 2023-06-10
+ *
+ */
+
+#ifndef __EVENT_PAYLOAD_H
+#define __EVENT_PAYLOAD_H
+
+#include <stdio.h>
+#include "Measurement_Snapshot.h"
+
+/**
+ * @brief The values sent with a measurement that are not part of it
+ *
+ */
+struct EventCounters {
+    int resets;                                         // sysStatus resetCount
+    int alerts;                                         // current alertCode
+    int connectTime;                                    // sysStatus lastConnectionDuration in seconds
+    unsigned lidActivity;                               // current lidActivity
+    unsigned long timeStamp;                            // Seconds - sent in milliseconds
+};
+
+/**
+ * @brief Formats the webhook payload into a caller supplied buffer
+ *
+ * @returns The snprintf result - the payload length
+ */
+inline int formatEventPayload(char *data, size_t len, const Measurement &reading, const EventCounters &counters) {
+    return snprintf(data, len, "{\"height\":%i, \"percentfull\":%4.2f, \"trashcanemptied\":%d, \"lidposition\":%i, \"battery\":%4.2f, \"temp\":%4.2f, \"resets\":%i, \"alerts\":%i,\"connecttime\":%i,\"lidactivity\":%u,\"timestamp\":%lu000}",
+        reading.trashHeight, reading.percentFull, reading.trashcanEmptied, reading.lidPosition, reading.batteryVoltage, reading.internalTempC,
+        counters.resets, counters.alerts, counters.connectTime, counters.lidActivity, counters.timeStamp);
+}
+
+#endif  /* __EVENT_PAYLOAD_H */
@@ -0,0 +1,83 @@
+/*
+ * @file Event_Queue.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Lock-free single producer / single consumer queue - the producer is an interrupt service routine (or
+ * several that cannot preempt each other) and the consumer is the main loop.  No Particle dependencies so it
+ * builds on a Linux host as well.
+ *
+ * @version 0.1
+ * @date 2023-03-18
+ *
+ */
+
+#ifndef __EVENT_QUEUE_H
+#define __EVENT_QUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+
+/**
+ * @brief Fixed size ring - SIZE must be a power of two no larger than 128
+ *
+ * @details If the consumer falls behind, new items are dropped (and counted) rather than overwriting
+ * ones the consumer may be reading.
+ *
+ */
+template <typename T, uint8_t SIZE>
+class EventQueue {
+public:
+    static_assert(SIZE > 0 && SIZE <= 128 && (SIZE & (SIZE - 1)) == 0, "EventQueue size must be a power of two <= 128");
+
+    /**
+     * @brief Adds an item - call from the producer only (ISR safe)
+     *
+     * @returns false if the queue was full and the item was dropped
+     */
+    bool push(const T &item) {
+        uint8_t h = head.load(std::memory_order_relaxed);
+        if ((uint8_t)(h - tail.load(std::memory_order_acquire)) >= SIZE) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        items[h & (SIZE - 1)] = item;
+        head.store((uint8_t)(h + 1), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item - call from the consumer only
+     *
+     * @returns false if the queue was empty
+     */
+    bool pop(T &item) {
+        uint8_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = items[t & (SIZE - 1)];
+        tail.store((uint8_t)(t + 1), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Is there anything waiting for the consumer
+     *
+     */
+    bool available() const {
+        return tail.load(std::memory_order_acquire) != head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Items dropped because the queue was full - resets the count
+     *
+     */
+    uint16_t takeDropped() {
+        return dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+private:
+    T items[SIZE];
+    std::atomic<uint8_t> head{0};                       // Written by the producer only
+    std::atomic<uint8_t> tail{0};                       // Written by the consumer only
+    std::atomic<uint16_t> dropped{0};
+};
+
+#endif  /* __EVENT_QUEUE_H */
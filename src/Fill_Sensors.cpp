@@ -0,0 +1,188 @@
+//Particle Functions
+#include "Particle.h"
+#include "device_pinout.h"
+#include "Fill_Sensors.h"
+#include "SparkFun_VL53L1X.h"
+#include "LIS3DH.h"
+
+namespace {
+  const uint8_t defaultTofAddress = 0x52;                         // 8-bit address after power up or XSHUT
+  const uint8_t firstTofAddress = 0x54;                           // Then one every 2 - clear of the accelerometer, FRAM and RTC
+  const unsigned long rangingStaggerMs = 5;                       // Start offsets so the emitters do not all fire together
+  const uint8_t outOfWindow = 2;                                  // setDistanceThreshold() window - interrupt below low or above high
+  const uint8_t inWindow = 3;                                     // With 0 to 0xFFFF this is every measurement - back to plain data ready
+
+  struct AccelProfileDef {
+    const char *name;
+    uint8_t rate;                                                 // LIS3DH::RATE_xx_HZ
+    bool lowPower;                                                // 8-bit low power mode
+    uint8_t wakeThreshold;                                        // Movement interrupt on INT1 - 0 for none
+    float microAmps;                                              // LIS3DH datasheet typical supply current at this rate and mode
+  };
+
+  // Indexed by AccelProfile
+  const AccelProfileDef accelProfiles[ACCEL_PROFILE_COUNT] = {
+    {"sleep", LIS3DH::RATE_10_HZ, true, 16, 3.0},                // 16 = 250 mg - a lid being moved or the can tipped
+    {"sample", LIS3DH::RATE_100_HZ, false, 0, 20.0},
+  };
+}
+
+// *****************  VL53L1X Range Sensors *******************
+//
+// ************************************************************
+
+Vl53l1xRange::Vl53l1xRange() {
+  sensors[0] = new SFEVL53L1X(Wire);                                  // No XSHUT, its GPIO is TOF_INT_PIN
+  fittedSensors = 1;
+  for (uint8_t i = 0; i < TOF_XSHUT_COUNT && fittedSensors < MAX_SENSORS; i++) {
+    sensors[fittedSensors++] = new SFEVL53L1X(Wire, TOF_XSHUT_PINS[i]);
+  }
+}
+
+uint8_t Vl53l1xRange::begin() {
+  SFEVL53L1X &primary = *sensors[0];
+
+  sensorCount = 0;
+  for (uint8_t i = 1; i < fittedSensors; i++) {
+    sensors[i]->sensorOff();                                           // Back in reset - nothing else answers at the default address
+    sensors[i]->setI2CAddress(defaultTofAddress);                      // Where it will be when released (the write goes nowhere)
+  }
+
+  // The primary has no XSHUT - it is at the default address after a power up but may still be moved from before a reset
+  if (!primary.checkID()) primary.setI2CAddress((primary.getI2CAddress() == defaultTofAddress) ? firstTofAddress : defaultTofAddress);
+  if (primary.begin() != 0) return 0;                                  // Begin returns 0 on a good init
+  sensorCount = 1;
+  if (fittedSensors == 1) return sensorCount;
+
+  primary.setI2CAddress(firstTofAddress);                              // Out of the way of the next one
+  for (uint8_t i = 1; i < fittedSensors; i++) {
+    sensors[i]->sensorOn();                                            // Boots at the default address
+    if (sensors[i]->begin() != 0) {                                    // Fitted in order - the first missing one ends the chain
+      sensors[i]->sensorOff();
+      break;
+    }
+    sensors[i]->setI2CAddress(firstTofAddress + 2 * i);
+    sensorCount++;
+  }
+
+  if (sensorCount == 1) primary.setI2CAddress(defaultTofAddress);      // Just the one - leave it where a power up puts it
+  return sensorCount;
+}
+
+bool Vl53l1xRange::responding() {
+  if (sensorCount == 0) return false;
+  for (uint8_t i = 0; i < sensorCount; i++) {
+    if (!sensors[i]->checkID()) return false;
+  }
+  return true;
+}
+
+void Vl53l1xRange::temperatureUpdate() {
+  for (uint8_t i = 0; i < sensorCount; i++) sensors[i]->startTemperatureUpdate();
+}
+
+void Vl53l1xRange::startRanging() {
+  for (uint8_t i = 0; i < sensorCount; i++) {
+    sensors[i]->stopRanging();
+    sensors[i]->clearInterrupt();
+    sensors[i]->setROI(8,8,199);                                       // Set the ROI to 8 pixels wide by 8 pixels high centered on the sensor
+  }
+  delay(1);
+  for (uint8_t i = 0; i < sensorCount; i++) {                          // All ranging at once - N sensors cost about one ranging period
+    if (i > 0) delay(rangingStaggerMs);
+    sensors[i]->startRanging();                                        // Write configuration bytes to initiate measurement
+  }
+}
+
+bool Vl53l1xRange::dataReady() {
+  for (uint8_t i = 0; i < sensorCount; i++) {
+    if (!sensors[i]->checkForDataReady()) return false;
+  }
+  return true;
+}
+
+uint8_t Vl53l1xRange::read(uint16_t *mm, uint16_t *signalRate) {
+  uint8_t readings = 0;
+
+  for (uint8_t i = 0; i < sensorCount; i++) {
+    if (!sensors[i]->checkForDataReady()) continue;
+    uint16_t distance = sensors[i]->getDistance();
+    if (sensorCount > 1 && sensors[i]->getRangeStatus() != 0) continue;   // With others to fall back on, drop signal / sigma / wrap failures
+    mm[readings] = distance;
+    signalRate[readings] = sensors[i]->getSignalRate();
+    readings++;
+  }
+  return readings;
+}
+
+void Vl53l1xRange::standby() {
+  for (uint8_t i = 0; i < sensorCount; i++) {
+    sensors[i]->clearInterrupt();
+    sensors[i]->stopRanging();
+  }
+}
+
+void Vl53l1xRange::armThresholds(uint16_t lowMm, uint16_t highMm, uint16_t periodMs) {
+  SFEVL53L1X &primary = *sensors[0];
+
+  primary.setInterruptPolarityHigh();                                  // TOF_INT_PIN wakes us on a rising edge
+  primary.setDistanceThreshold(lowMm, highMm, outOfWindow);
+  primary.setTimingBudgetInMs(100);
+  primary.setIntermeasurementPeriod(periodMs);
+  primary.clearInterrupt();
+  primary.startRanging();
+}
+
+void Vl53l1xRange::disarmThresholds() {
+  SFEVL53L1X &primary = *sensors[0];
+
+  primary.stopRanging();
+  primary.setDistanceThreshold(0, 0xFFFF, inWindow);                   // Undo the autonomous thresholds so every measurement is data ready
+  primary.setIntermeasurementPeriod(100);
+}
+
+// *****************  LIS3DH Tilt Sensor *******************
+//
+// *********************************************************
+
+Lis3dhTilt::Lis3dhTilt() {
+  accel = new LIS3DHI2C(Wire, 0, INT_PIN);
+}
+
+bool Lis3dhTilt::setProfile(AccelProfile profile) {
+  const AccelProfileDef &def = accelProfiles[profile];
+  LIS3DHConfig config;
+
+  if (def.wakeThreshold) {
+    config.setLowPowerWakeMode(def.wakeThreshold);                    // Interrupt, high pass filter and latch on INT1
+  }
+  else {
+    config.setAccelMode(def.rate);
+  }
+  config.reg1 = def.rate | LIS3DH::CTRL_REG1_ZEN | LIS3DH::CTRL_REG1_YEN | LIS3DH::CTRL_REG1_XEN;
+  if (def.lowPower) config.reg1 |= LIS3DH::CTRL_REG1_LPEN;
+
+  return accel->setup(config);
+}
+
+uint8_t Lis3dhTilt::clearInterrupt() {
+  return accel->readRegister8(LIS3DH::REG_INT1_SRC);                  // Reading it releases the latch - not LIS3DH::clearInterrupt(), which waits for INT_PIN to fall while the lid keeps moving
+}
+
+void Lis3dhTilt::logProfiles() {
+  for (const AccelProfileDef &profile : accelProfiles) {
+    Log.info("Accelerometer %s profile: %s mode, %s - %4.1fuA", profile.name, profile.lowPower ? "8-bit low power" : "normal", (profile.wakeThreshold) ? "wake on movement" : "no interrupt", profile.microAmps);
+  }
+  float sampleHours = (SETTLE_MS / 1000.0) / 3600.0;                  // One reading an hour
+  Log.info("Accelerometer average %5.2fuA at one reading an hour", accelProfiles[ACCEL_SAMPLE].microAmps * sampleHours + accelProfiles[ACCEL_SLEEP].microAmps * (1.0 - sampleHours));
+}
+
+bool Lis3dhTilt::getSample(int16_t &x, int16_t &y, int16_t &z) {
+  LIS3DHSample sample;
+
+  if (!accel->getSample(sample)) return false;
+  x = sample.x;
+  y = sample.y;
+  z = sample.z;
+  return true;
+}
@@ -0,0 +1,139 @@
+/*
+ * @file Fill_Sensors.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Sensor policies for Measure_TrashT - each range (fill level) and tilt (lid position) sensor is a plain
+ * class with the same member functions.  The pair is picked at compile time as template arguments, so a build
+ * for an ultrasonic or alternate TOF sensor costs no virtual calls or vtables.
+ *
+ * @version 0.1
+ * @date 2023-04-22
+ *
+ */
+
+#ifndef __FILL_SENSORS_H
+#define __FILL_SENSORS_H
+
+#include "Particle.h"
+
+class SFEVL53L1X;
+class LIS3DHI2C;
+
+/**
+ * @brief Tilt sensor power profiles - what each one means in hardware is up to the tilt sensor policy
+ *
+ */
+enum AccelProfile : uint8_t {
+    ACCEL_SLEEP = 0,                                    // Lowest power between readings - wakes us on movement if it can
+    ACCEL_SAMPLE,                                       // Full rate - only while we take a reading
+    ACCEL_PROFILE_COUNT                                 // Keep last
+};
+
+/**
+ * A range sensor policy provides:
+ *
+ * static const uint8_t MAX_SENSORS;                    Readings read() can return at most
+ * uint8_t begin();                                     Sensors found and initialized - 0 if none
+ * bool responding();                                   Every sensor found by begin() still answers
+ * uint8_t count() const;
+ * void temperatureUpdate();                            Recalibrate for a temperature change
+ * void startRanging();                                 One measurement from every sensor in the same power window
+ * bool dataReady();                                    Every sensor has its result
+ * uint8_t read(uint16_t *mm, uint16_t *signalRate);    Good results - signal rate is a relative confidence
+ * void standby();                                      Stop ranging - lowest power that keeps the configuration
+ * void armThresholds(uint16_t lowMm, uint16_t highMm, uint16_t periodMs);   Range on its own, interrupt on TOF_INT_PIN outside the window
+ * void disarmThresholds();                             Back to ranging on request
+ */
+
+/**
+ * @brief ST VL53L1X time of flight sensors - the one on the carrier plus one per TOF_XSHUT_PINS on large containers
+ *
+ */
+class Vl53l1xRange {
+public:
+    static const uint8_t MAX_SENSORS = 4;
+
+    Vl53l1xRange();
+
+    /**
+     * @brief XSHUT sequencing - gives each sensor its own I2C address
+     *
+     * @details The extra sensors are held in reset, the primary is moved off the default address and then each
+     * extra sensor is released, initialized at the default address and moved to the next one.  Run again
+     * whenever a sensor stops answering at its address (ENABLE_PIN power cycle or a reset that released XSHUT).
+     *
+     * @returns Number of sensors that answered
+     */
+    uint8_t begin();
+
+    bool responding();
+
+    uint8_t count() const { return sensorCount; }
+
+    void temperatureUpdate();
+
+    void startRanging();
+
+    bool dataReady();
+
+    /**
+     * @details With more than one sensor, readings with a signal, sigma or wrap failure are dropped
+     */
+    uint8_t read(uint16_t *mm, uint16_t *signalRate);
+
+    /**
+     * @details Software standby - XSHUT would lose the extra sensors' addresses
+     */
+    void standby();
+
+    /**
+     * @details Only the primary sensor - its GPIO is the one wired to TOF_INT_PIN
+     */
+    void armThresholds(uint16_t lowMm, uint16_t highMm, uint16_t periodMs);
+
+    void disarmThresholds();
+
+private:
+    SFEVL53L1X *sensors[MAX_SENSORS];                   // [0] has no XSHUT
+    uint8_t fittedSensors = 0;                          // Sensor objects - 1 + the XSHUT pins we have
+    uint8_t sensorCount = 0;                            // Found by begin()
+};
+
+/**
+ * A tilt sensor policy provides:
+ *
+ * bool setProfile(AccelProfile profile);               Also clears a latched wake interrupt - false if no response
+ * uint8_t clearInterrupt();                            Releases a latched wake interrupt - non-zero if there was one
+ * void logProfiles();                                  Boot time summary of the profiles' power use
+ * bool getSample(int16_t &x, int16_t &y, int16_t &z);  1g is about 16000 on each axis
+ * static const unsigned long SETTLE_MS;                From ACCEL_SAMPLE to the first good sample
+ */
+
+/**
+ * @brief ST LIS3DH accelerometer on I2C - wakes us on movement on INT_PIN
+ *
+ */
+class Lis3dhTilt {
+public:
+    static const unsigned long SETTLE_MS = 20;          // First sample is ready 1/ODR + 1ms after a mode change
+
+    Lis3dhTilt();
+
+    bool setProfile(AccelProfile profile);
+
+    /**
+     * @details The sleep profile latches INT1 - INT_PIN stays high, and no new edge can wake us, until this is called.
+     * One register read - it does not wait for the movement to stop.
+     *
+     * @returns The INT1_SRC register - LIS3DH::INT1_SRC_IA is set if movement was latched
+     */
+    uint8_t clearInterrupt();
+
+    void logProfiles();
+
+    bool getSample(int16_t &x, int16_t &y, int16_t &z);
+
+private:
+    LIS3DHI2C *accel;
+};
+
+#endif  /* __FILL_SENSORS_H */
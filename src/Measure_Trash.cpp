@@ -1,50 +1,95 @@
-
 //Particle Functions
 #include "Particle.h"
 #include "MyPersistentData.h"
 #include "device_pinout.h"
 #include "Measure_Trash.h"
-#include "SparkFun_VL53L1X.h"
-#include "LIS3DH.h"
+#include "Binary_Log.h"
+
+template <typename RangeSensorT, typename TiltSensorT>
+Measure_TrashT<RangeSensorT, TiltSensorT> *Measure_TrashT<RangeSensorT, TiltSensorT>::_instance;
+
+namespace {
+  const unsigned long rangingTimeoutMs = 10000;
+
+  // Autonomous TOF ranging - the sensor interrupts when the fill level leaves its band
+  const float fillBands[] = {50.0, 75.0, 90.0};                   // Percent full band edges
+  const uint16_t autonomousPeriodMs = 60000;                      // Time between autonomous measurements
+  const uint16_t bandMarginMm = 25;                               // Hysteresis so a reading on a band edge does not chatter
+
+  // Temperature compensation
+  const float vhvUpdateDeltaC = 8.0;                              // ST: rerun the temperature update after an 8C change
+  const float minCalSamples = 10;                                 // Before we trust the fit
+  const float maxCalSamples = 60;                                 // About two months of emptyings - then the history is halved so older weather counts for less
+  const float emptyBandMm = 50.0;                                 // An emptied can reading further than this from the reference is not learned - a bag left in
+  const float minValidTempC = -40.0;                              // Outside this the internal temperature reading is suspect
+  const float maxValidTempC = 85.0;
+
+  // Distances, so the fullest spot is the smallest reading
+  int fuseDistances(uint16_t *mm, const uint16_t *signalRate, uint8_t count, uint8_t mode) {
+    if (count == 1) return mm[0];
+
+    if (mode == Measure_Trash::FUSION_WEIGHTED) {
+      uint32_t totalRate = 0;
+      uint32_t weightedMm = 0;
+      for (uint8_t i = 0; i < count; i++) {
+        totalRate += signalRate[i];
+        weightedMm += (uint32_t)mm[i] * signalRate[i];
+      }
+      if (totalRate > 0) return weightedMm / totalRate;
+      mode = Measure_Trash::FUSION_MEDIAN;                        // No signal rates - fall back
+    }
 
-Measure_Trash *Measure_Trash::_instance;
+    for (uint8_t i = 1; i < count; i++) {                         // Insertion sort - only a few readings
+      uint16_t value = mm[i];
+      int j = i - 1;
+      for (; j >= 0 && mm[j] > value; j--) mm[j + 1] = mm[j];
+      mm[j + 1] = value;
+    }
+    if (mode == Measure_Trash::FUSION_MEDIAN) return (count % 2) ? mm[count / 2] : (mm[count / 2 - 1] + mm[count / 2]) / 2;
+    return mm[0];                                                  // FUSION_MAX
+  }
 
-LIS3DHI2C accel(Wire, 0, INT_PIN);                   // Initialize the accelerometer in i2c mode
-SFEVL53L1X distanceSensor;                          // Initialize the TOF sensor - no interrupts
-LIS3DHSample sample;                                // Stores latest value from the accelerometer
+  // Distance from the sensor in mm for a fill level - the inverse of the percent full calculation in measureHeight()
+  uint16_t fillToDistanceMm(float percentFull) {
+    float inches = sysStatus.get_trashEmpty() - (percentFull / 100.0) * (sysStatus.get_trashEmpty() - sysStatus.get_trashFull());
+    return (uint16_t)(inches / 0.0393701);
+  }
+}
 
 // [static]
-Measure_Trash &Measure_Trash::instance() {
+template <typename RangeSensorT, typename TiltSensorT>
+Measure_TrashT<RangeSensorT, TiltSensorT> &Measure_TrashT<RangeSensorT, TiltSensorT>::instance() {
   if (!_instance) {
-      _instance = new Measure_Trash();
+      _instance = new Measure_TrashT();
   }
   return *_instance;
 }
 
-Measure_Trash::Measure_Trash() {
+template <typename RangeSensorT, typename TiltSensorT>
+Measure_TrashT<RangeSensorT, TiltSensorT>::Measure_TrashT() {
 }
 
-Measure_Trash::~Measure_Trash() {
+template <typename RangeSensorT, typename TiltSensorT>
+Measure_TrashT<RangeSensorT, TiltSensorT>::~Measure_TrashT() {
 }
 
-bool Measure_Trash::setup() {
+template <typename RangeSensorT, typename TiltSensorT>
+bool Measure_TrashT<RangeSensorT, TiltSensorT>::setup() {
   bool setupSuccess = true;
 
   Log.info("Starting the TOF sensor");
 
-  if (distanceSensor.begin() != 0)                                    // Begin returns 0 on a good init
+  if (range.begin() == 0)                                              // The primary sensor did not initialize
   {
     Log.info("TOF sensor initialization failed - ERROR State");
     setupSuccess = false;
   }
-  else Log.info("TOF Sensor initialized");
-
-  // Initialize Accelerometer sensor
-	LIS3DHConfig config;
-	config.setAccelMode(LIS3DH::RATE_100_HZ);
+  else Log.info("TOF Sensor initialized - %u sensor%s", range.count(), (range.count() == 1) ? "" : "s");
 
-  if (accel.setup(config)) {
+  // Initialize Accelerometer sensor - it spends all but the sampling window in the low power sleep profile
+  if (setAccelProfile(ACCEL_SLEEP)) {
     Log.info("Accelerometer Initialized");
+    tilt.logProfiles();
   }
   else {
     Log.info("Accelerometer failed initialization - entering ERROR state");
@@ -55,87 +100,199 @@ bool Measure_Trash::setup() {
 
 }
 
-void Measure_Trash::loop() {
+template <typename RangeSensorT, typename TiltSensorT>
+void Measure_TrashT<RangeSensorT, TiltSensorT>::loop() {
     // Put your code to run during the application thread loop here
 }
 
-void Measure_Trash::measureHeight() // This is where we check to see if an interrupt is set when not asleep or act on a tap that woke the device
+template <typename RangeSensorT, typename TiltSensorT>
+void Measure_TrashT<RangeSensorT, TiltSensorT>::measureHeight(Measurement &reading) // This is where we check to see if an interrupt is set when not asleep or act on a tap that woke the device
 {
-  float lastPercentFull = current.get_percentFull();                   // Going to see if the trashcan was emptied
+  float lastPercentFull = reading.percentFull;                         // Going to see if the trashcan was emptied
   int successfulRead = 2;
 
   // Read the height of the trash in the can
-  distanceSensor.sensorOff();                                          // Turn off the sensor
-  delay(100);
-  distanceSensor.sensorOn();                                           // Fire up the sensor
+  if (!range.responding()) range.begin();                              // Power was cut or a reset released XSHUT - addresses are back to the default
 
-  // focus the detection area
-  distanceSensor.stopRanging();
-  distanceSensor.clearInterrupt();
-  distanceSensor.setROI(8,8,199);                                      // Set the ROI to 8 pixels wide by 8 pixels high centered on the sensor
-  delay(1);
-  distanceSensor.startRanging();                                       // Write configuration bytes to initiate measurement
+  float tempC = reading.internalTempC;                                 // Measured just before us in takeMeasurements()
+  bool tempValid = (tempC >= minValidTempC && tempC <= maxValidTempC);
+  if (tempValid) temperatureUpdate(tempC);
 
-  waitFor(distanceSensor.checkForDataReady,10000);
+  if (thresholdsArmed) {                                               // Even if autonomous ranging was just turned off - a reading inside the old window would never be data ready
+    range.disarmThresholds();
+    thresholdsArmed = false;
+  }
+  range.startRanging();
 
-  if (distanceSensor.checkForDataReady()) {
+  for (unsigned long start = millis(); !range.dataReady() && millis() - start < rangingTimeoutMs; ) delay(1);
+
+  uint16_t readingsMm[RangeSensorT::MAX_SENSORS];
+  uint16_t signalRates[RangeSensorT::MAX_SENSORS];
+  uint8_t readings = range.read(readingsMm, signalRates);
+
+  if (readings > 0) {
     // Calculate the height of the trash in the can
-    current.set_trashHeight(int(distanceSensor.getDistance() * 0.0393701)); //Get the result of the measurement from the sensor
-    if (isnan(current.get_trashHeight())) {
+    int distanceMm = fuseDistances(readingsMm, signalRates, readings, sysStatus.get_tofFusion());
+    float correctedMm = distanceMm;
+    if (tempValid) correctedMm -= temperatureCorrectionMm(tempC);
+    reading.trashHeight = int(correctedMm * 0.0393701);
+    if (isnan(reading.trashHeight)) {
       successfulRead--;
-      Log.info("Data ready but not valid");
+      Binary_Log::instance().trace(Binary_Log::MSG_TRACE_TOF, 1, distanceMm);
+      Binary_Log::instance().record(Binary_Log::MSG_TOF_NOT_VALID);
+    }
+    else {
+      Binary_Log::instance().trace(Binary_Log::MSG_TRACE_TOF, 0, distanceMm);
+      Binary_Log::instance().record(Binary_Log::MSG_TOF_DISTANCE, reading.trashHeight);
     }
-    else Log.info("Data ready and distance is %i\"", current.get_trashHeight());
 
     // Calculate percent full and log information
-    current.set_trashHeight(constrain(current.get_trashHeight(),sysStatus.get_trashFull(),sysStatus.get_trashEmpty()));
-    current.set_percentFull(((float)((sysStatus.get_trashEmpty()-sysStatus.get_trashFull()) - (current.get_trashHeight() - sysStatus.get_trashFull()))/(sysStatus.get_trashEmpty()-sysStatus.get_trashFull()))*100);
+    reading.trashHeight = constrain(reading.trashHeight,sysStatus.get_trashFull(),sysStatus.get_trashEmpty());
+    reading.percentFull = ((float)((sysStatus.get_trashEmpty()-sysStatus.get_trashFull()) - (reading.trashHeight - sysStatus.get_trashFull()))/(sysStatus.get_trashEmpty()-sysStatus.get_trashFull()))*100;
 
     // Was trashcan emptied?
-    if (current.get_percentFull() < 20.0 && lastPercentFull > 30.0) current.set_trashcanEmptied(true);
-    else current.set_trashcanEmptied(false);
+    if (reading.percentFull < 20.0 && lastPercentFull > 30.0) reading.trashcanEmptied = true;
+    else reading.trashcanEmptied = false;
+
+    // Only a can we just saw emptied is known to be empty - any other low reading may have trash in it
+    if (tempValid && reading.trashcanEmptied) learnTemperatureError(tempC, distanceMm);
   }
   else {
-    Log.info("TOF Data not ready");
+    Binary_Log::instance().trace(Binary_Log::MSG_TRACE_TOF, 2, 0);
+    Binary_Log::instance().record(Binary_Log::MSG_TOF_NOT_READY);
     successfulRead--;
   }
 
-  distanceSensor.clearInterrupt();
-  distanceSensor.stopRanging();
-  distanceSensor.sensorOff();                                          // Done - turn that puppy off 
+  range.standby();
+  if (sysStatus.get_tofAutonomous()) armAutonomousRanging(reading.percentFull);  // Keeps ranging on its own and wakes us on a band crossing
+
+  // Read the accelerometer to see if the trashcan lid is on its side - a short full rate window then back to sleep
+  int16_t x, y, z;
 
-  // Read the accelerometer to see if the trashcan lid is on its side
-  LIS3DHSample sample;
+  setAccelProfile(ACCEL_SAMPLE);
+  delay(TiltSensorT::SETTLE_MS);
+  bool gotSample = tilt.getSample(x, y, z);
+  setAccelProfile(ACCEL_SLEEP);                                        // Also clears a latched wake interrupt
 
-  if (accel.getSample(sample)) {
+  if (gotSample) {
+    Binary_Log::instance().trace(Binary_Log::MSG_TRACE_ACCEL, 1, x, y, z);
     int threshold = 10000;
-    if (sample.z > threshold) {
-      Log.info("Lid rightside up with x:%d, y:%d, z:%d", sample.x, sample.y, sample.z);
-      current.set_lidPosition(5);
-    }
-    else if (sample.z < -1 * threshold) {
-      Log.info("Lid upside down x:%d, y:%d, z:%d", sample.x, sample.y, sample.z);
-      current.set_lidPosition(6);
-    }
-    else {
-      Log.info("Lid on side x:%d, y:%d, z:%d", sample.x, sample.y, sample.z);
-      current.set_lidPosition(1);
-    }
+    if (z > threshold) reading.lidPosition = 5;                      // Rightside up
+    else if (z < -1 * threshold) reading.lidPosition = 6;            // Upside down
+    else reading.lidPosition = 1;                                    // On its side
+    Binary_Log::instance().record(Binary_Log::MSG_LID_POSITION, reading.lidPosition, x, y, z);
   }
   else {
     successfulRead--;
-    Serial.println("Accelerometer had no sample");
+    Binary_Log::instance().trace(Binary_Log::MSG_TRACE_ACCEL, 0, 0, 0, 0);
+    Binary_Log::instance().record(Binary_Log::MSG_ACCEL_NO_SAMPLE);
   }
 
   if (successfulRead < 2) {
-    Log.info("Not all sensors read successfully");
-    current.set_trashHeight(0);
-    current.set_percentFull(0);
-    current.set_lidPosition(0);
+    Binary_Log::instance().record(Binary_Log::MSG_SENSORS_FAILED);
+    reading.trashHeight = 0;
+    reading.percentFull = 0;
+    reading.trashcanEmptied = false;                                   // Or the last emptying is counted again
+    reading.lidPosition = 0;
   }
   else {
-    Log.info("Trash height is %i\" and can is %4.1f%% full and %s emptied.  The lid is %s", current.get_trashHeight(),current.get_percentFull(), (current.get_trashcanEmptied()) ? "was": "was not", (current
-    .get_lidPosition() == 1) ? "on its side" : (current.get_lidPosition() == 5) ? "right side up" : "upside down");
+    Binary_Log::instance().record(Binary_Log::MSG_TRASH_SUMMARY, reading.trashHeight, reading.percentFull, reading.trashcanEmptied);
   }
 
-}
\ No newline at end of file
+}
+
+template <typename RangeSensorT, typename TiltSensorT>
+bool Measure_TrashT<RangeSensorT, TiltSensorT>::setAccelProfile(AccelProfile profile) {
+  return tilt.setProfile(profile);
+}
+
+template <typename RangeSensorT, typename TiltSensorT>
+uint8_t Measure_TrashT<RangeSensorT, TiltSensorT>::clearAccelInterrupt() {
+  return tilt.clearInterrupt();
+}
+
+template <typename RangeSensorT, typename TiltSensorT>
+uint8_t Measure_TrashT<RangeSensorT, TiltSensorT>::tofSensorCount() const {
+  return range.count();
+}
+
+template <typename RangeSensorT, typename TiltSensorT>
+void Measure_TrashT<RangeSensorT, TiltSensorT>::armAutonomousRanging(float percentFull) {
+  float lowerEdge = 0.0;                                              // The band the can is in now
+  float upperEdge = 100.0;
+
+  for (float edge : fillBands) {
+    if (percentFull >= edge) lowerEdge = edge;
+    else if (upperEdge == 100.0) upperEdge = edge;
+  }
+
+  // Fuller means closer - the upper fill edge is the low distance threshold
+  uint16_t lowMm = fillToDistanceMm(upperEdge);
+  uint16_t highMm = fillToDistanceMm(lowerEdge) + bandMarginMm;
+  lowMm = (lowMm > bandMarginMm) ? lowMm - bandMarginMm : 0;
+
+  range.armThresholds(lowMm, highMm, autonomousPeriodMs);
+  thresholdsArmed = true;
+  Log.info("TOF ranging every %us - interrupt below %umm or above %umm (%2.0f%% to %2.0f%% full)", autonomousPeriodMs / 1000, lowMm, highMm, lowerEdge, upperEdge);
+}
+
+template <typename RangeSensorT, typename TiltSensorT>
+void Measure_TrashT<RangeSensorT, TiltSensorT>::temperatureUpdate(float tempC) {
+  float calTempC = tofCal.get_calTempC();
+
+  if (isnan(calTempC) || fabs(tempC - calTempC) > vhvUpdateDeltaC) {
+    Log.info("TOF temperature update at %4.1fC (last at %4.1fC)", tempC, calTempC);
+    range.temperatureUpdate();
+    tofCal.set_calTempC(tempC);
+  }
+}
+
+template <typename RangeSensorT, typename TiltSensorT>
+void Measure_TrashT<RangeSensorT, TiltSensorT>::learnTemperatureError(float tempC, int distanceMm) {
+  tofCalData::Fit fit = tofCal.get_fit();
+
+  if (fit.referenceMm == 0) {                                         // First emptying - the errors are measured from here
+    if (fabs(distanceMm - sysStatus.get_trashEmpty() / 0.0393701) > emptyBandMm) return;
+    fit = {};                                                         // Anything learned before was against trashEmpty
+    fit.referenceMm = distanceMm;
+    tofCal.set_fit(fit);
+    Log.info("TOF temperature reference %imm at %4.1fC", distanceMm, tempC);
+    return;
+  }
+
+  float errorMm = distanceMm - fit.referenceMm;
+  if (fabs(errorMm) > emptyBandMm) return;
+
+  if (fit.samples >= maxCalSamples) {                                 // Age the history so the fit follows the sensor
+    fit.samples /= 2;
+    fit.sumT /= 2;
+    fit.sumE /= 2;
+    fit.sumTT /= 2;
+    fit.sumTE /= 2;
+  }
+  fit.samples += 1;
+  fit.sumT += tempC;
+  fit.sumE += errorMm;
+  fit.sumTT += tempC * tempC;
+  fit.sumTE += tempC * errorMm;
+  tofCal.set_fit(fit);                                                // One write - the FRAM object locks and hashes once
+}
+
+template <typename RangeSensorT, typename TiltSensorT>
+float Measure_TrashT<RangeSensorT, TiltSensorT>::temperatureCorrectionMm(float tempC) const {
+  tofCalData::Fit fit = tofCal.get_fit();
+  if (fit.samples < minCalSamples) return 0.0;
+
+  float denominator = fit.samples * fit.sumTT - fit.sumT * fit.sumT;
+  if (fabs(denominator) < 1.0) return fit.sumE / fit.samples;         // All at about one temperature - just the mean offset
+
+  float slope = (fit.samples * fit.sumTE - fit.sumT * fit.sumE) / denominator;
+  float intercept = (fit.sumE - slope * fit.sumT) / fit.samples;
+  return intercept + slope * tempC;
+}
+
+// The sensors this hardware carries - add a line here for each other combination that is built.  The host
+// harness in tools/host includes this file and instantiates its mock sensors instead.
+#if defined(PLATFORM_ID)
+template class Measure_TrashT<Vl53l1xRange, Lis3dhTilt>;
+#endif
@@ -12,24 +12,42 @@
 #define __MEASURE_TRASH_H
 
 #include "Particle.h"
+#include "Fill_Sensors.h"
+#include "Measurement_Snapshot.h"
 
 /**
  * This class is a singleton; you do not create one as a global, on the stack, or with new.
  * 
+ * The sensors are template arguments - see Fill_Sensors.h for what a range and a tilt sensor policy provide.
+ * Measure_Trash is the pair this hardware carries; a build for other sensors changes the typedef at the bottom
+ * and the explicit instantiation at the bottom of Measure_Trash.cpp.
+ * 
  * From global application setup you must call:
  * Measure_Trash::instance().setup();
  * 
  * From global application loop you must call:
  * Measure_Trash::instance().loop();
  */
-class Measure_Trash {
+template <typename RangeSensorT, typename TiltSensorT>
+class Measure_TrashT {
 public:
+    /**
+     * @brief How the readings are combined when a big container has more than one TOF sensor - stored in sysStatus
+     * 
+     */
+    enum TofFusion : uint8_t {
+        FUSION_MAX = 0,                                 // The fullest spot - trash piles up under one sensor
+        FUSION_MEDIAN,                                  // Ignores one sensor that sees something odd
+        FUSION_WEIGHTED,                                // Mean weighted by each sensor's signal rate
+        FUSION_COUNT                                    // Keep last
+    };
+
     /**
      * @brief Gets the singleton instance of this class, allocating it if necessary
      * 
      * Use Measure_Trash::instance() to instantiate the singleton.
      */
-    static Measure_Trash &instance();
+    static Measure_TrashT &instance();
 
     /**
      * @brief Perform setup operations; call this from global application setup()
@@ -52,8 +70,52 @@ public:
      * is the same regardless.  The sensor will trigger an interrupt, which will set a flag. In the main loop
      * that flag will call this function which will determine if this event should "count" as a visitor.
      * 
+     * @param reading the measurement being built - internalTempC must already be set; trashHeight, percentFull,
+     * trashcanEmptied and lidPosition are filled in.  Nothing is written to current here.
+     */
+    void measureHeight(Measurement &reading);           // Determine height of trash in the trashcan
+
+    /**
+     * @brief Reconfigures the tilt sensor for a power profile - also clears a latched wake interrupt
+     * 
+     * @returns false if the tilt sensor did not respond
+     */
+    bool setAccelProfile(AccelProfile profile);
+
+    /**
+     * @brief Releases the tilt sensor's latched wake interrupt so the next movement is a new edge on INT_PIN
+     * 
+     * @details Call once a movement has been handled and before sleeping
+     * 
+     * @returns Non-zero if an interrupt was latched
+     */
+    uint8_t clearAccelInterrupt();
+
+    /**
+     * @brief Range sensors found and addressed - 0 if the primary sensor did not respond
+     * 
+     */
+    uint8_t tofSensorCount() const;
+
+    /**
+     * @brief Leaves the TOF sensor ranging slowly on its own with its GPIO interrupt (TOF_INT_PIN) armed for the
+     * distances where the can would move out of its current fill band - full or emptied
+     * 
+     * @details Called at the end of measureHeight() when sysStatus.get_tofAutonomous() is set.  Only the primary
+     * sensor ranges autonomously - its GPIO is the one wired to TOF_INT_PIN
+     * 
+     */
+    void armAutonomousRanging(float percentFull);
+
+    /**
+     * @brief Learned TOF error at a temperature - subtract from the raw distance
+     * 
+     * @details Least squares fit of error vs temperature from readings of the empty can (a known distance).
+     * Zero until enough samples have been collected.
+     * 
+     * @returns Error in mm
      */
-    void measureHeight();                               // Determine height of trash in the trashcan
+    float temperatureCorrectionMm(float tempC) const;
 
 protected:
     /**
@@ -61,29 +123,48 @@ protected:
      * 
      * Use Measure_Trash::instance() to instantiate the singleton.
      */
-    Measure_Trash();
+    Measure_TrashT();
 
     /**
      * @brief The destructor is protected because the class is a singleton and cannot be deleted
      */
-    virtual ~Measure_Trash();
+    ~Measure_TrashT();
 
     /**
      * This class is a singleton and cannot be copied
      */
-    Measure_Trash(const Measure_Trash&) = delete;
+    Measure_TrashT(const Measure_TrashT&) = delete;
 
     /**
      * This class is a singleton and cannot be copied
      */
-    Measure_Trash& operator=(const Measure_Trash&) = delete;
+    Measure_TrashT& operator=(const Measure_TrashT&) = delete;
 
     /**
      * @brief Singleton instance of this class
      * 
      * The object pointer to this class is stored here. It's NULL at system boot.
      */
-    static Measure_Trash *_instance;
+    static Measure_TrashT *_instance;
 
+    /**
+     * @brief Runs the range sensor's temperature update if we have drifted too far from the last one
+     * 
+     */
+    void temperatureUpdate(float tempC);
+
+    /**
+     * @brief Adds a just emptied can reading to the error vs temperature fit
+     * 
+     * @details The first one is not a sample - its raw distance becomes the reference the errors are taken from
+     */
+    void learnTemperatureError(float tempC, int distanceMm);
+
+    RangeSensorT range;
+    TiltSensorT tilt;
+    bool thresholdsArmed = false;                       // Left ranging on its own by armAutonomousRanging()
 };
+
+typedef Measure_TrashT<Vl53l1xRange, Lis3dhTilt> Measure_Trash;
+
 #endif  /* __Measure_Trash_H */
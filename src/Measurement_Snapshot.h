@@ -0,0 +1,83 @@
+/*
+ * @file Measurement_Snapshot.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief The measurement record and a single writer sequence lock to share it - the application thread measures,
+ * the system thread (commands) and the publish path read a consistent copy without taking a mutex.  No Particle
+ * dependencies so it builds on a Linux host as well.
+ *
+ * @version 0.1
+ * @date 2023-05-13
+ *
+ */
+
+#ifndef __MEASUREMENT_SNAPSHOT_H
+#define __MEASUREMENT_SNAPSHOT_H
+
+#include <stdint.h>
+#include <time.h>
+#include <atomic>
+
+/**
+ * @brief One complete set of readings - committed to current (and FRAM) as a unit by takeMeasurements()
+ *
+ */
+struct Measurement {
+    int trashHeight;                                    // Height in inches
+    float percentFull;
+    time_t lastMeasureTime;                             // When these readings were taken
+    bool trashcanEmptied;
+    float internalTempC;                                // Enclosure temperature in degrees C
+    uint8_t lidPosition;                                // 0 = Unk, 1 - 4 Side, 5-Rightside up, 6-Upside down
+    float batteryVoltage;
+};
+
+/**
+ * @brief Sequence lock - one writer, any number of readers that retry if they overlap a write
+ *
+ * @details The sequence is odd while a write is in progress.  A reader copies the value between two reads of the
+ * sequence and keeps the copy only if both were the same even number.  Readers never block the writer; a reader
+ * on a higher priority thread than the writer must sleep (not spin) between tries so the write can finish.
+ *
+ */
+template <typename T>
+class SeqLock {
+public:
+    /**
+     * @brief Publish a new value - one writer thread only
+     *
+     */
+    void write(const T &value) {
+        uint32_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        data = value;
+        sequence.store(s + 2, std::memory_order_release);
+    }
+
+    /**
+     * @brief One attempt at a consistent copy
+     *
+     * @returns false if a write overlapped - try again
+     */
+    bool tryRead(T &value) const {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) return false;
+        value = data;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequence.load(std::memory_order_relaxed) == before;
+    }
+
+    /**
+     * @brief Bumped twice by each write - a reader can tell whether it has seen the latest value
+     *
+     */
+    uint32_t version() const {
+        return sequence.load(std::memory_order_acquire);
+    }
+
+private:
+    T data{};
+    std::atomic<uint32_t> sequence{0};
+};
+
+#endif  /* __MEASUREMENT_SNAPSHOT_H */
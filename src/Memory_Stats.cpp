@@ -0,0 +1,114 @@
+//Particle Functions
+#include "Particle.h"
+#include "MyPersistentData.h"
+#include "PublishQueuePosixRK.h"
+#include "Memory_Stats.h"
+
+Memory_Stats *Memory_Stats::_instance;
+
+namespace {
+  const unsigned long samplePeriodMs = 1000UL;                    // While awake - the heap walk is cheap but not free
+  const char * const threadNames[memStatsData::NUM_THREADS] = {nullptr, "system", "BackgroundPublish"};   // The application thread is found by handle
+
+  struct StackSample {
+    os_thread_t applicationThread;
+    uint32_t freeStack[memStatsData::NUM_THREADS];
+  };
+
+  // Called for each thread with the scheduler held - only copy the numbers out
+  os_result_t threadDumpCallback(os_thread_dump_info_t *info, void *ptr) {
+    StackSample *stacks = (StackSample *)ptr;
+    if (info->thread == stacks->applicationThread) stacks->freeStack[Memory_Stats::THREAD_APPLICATION] = info->stack_high_watermark;
+    else if (info->name) {
+      for (uint8_t thread = Memory_Stats::THREAD_SYSTEM; thread < memStatsData::NUM_THREADS; thread++) {
+        if (!strcmp(info->name, threadNames[thread])) stacks->freeStack[thread] = info->stack_high_watermark;
+      }
+    }
+    return 0;
+  }
+
+  // Minimums not seen today are sent as null
+  size_t appendMinimum(char *data, size_t len, size_t size, bool first, uint32_t value) {
+    if (len >= size) return len;
+    if (value == memStatsData::NOT_SAMPLED) return len + snprintf(&data[len], size - len, "%snull", (first) ? "" : ",");
+    return len + snprintf(&data[len], size - len, "%s%lu", (first) ? "" : ",", (unsigned long)value);
+  }
+}
+
+// [static]
+Memory_Stats &Memory_Stats::instance() {
+  if (!_instance) {
+      _instance = new Memory_Stats();
+  }
+  return *_instance;
+}
+
+Memory_Stats::Memory_Stats() {
+}
+
+Memory_Stats::~Memory_Stats() {
+}
+
+void Memory_Stats::setup() {
+  memStats.setup();
+  sample(currentState);                                           // Setup has done most of its allocating by now
+}
+
+void Memory_Stats::loop() {
+  memStats.loop();
+  if (millis() - lastSampleMillis >= samplePeriodMs) sample(currentState);
+}
+
+void Memory_Stats::recordTransition(uint8_t from, uint8_t to) {
+  sample(from);
+  currentState = to;
+}
+
+void Memory_Stats::sample(uint8_t state) {
+  lastSampleMillis = millis();
+  if (state >= memStatsData::NUM_STATES) return;
+
+  runtime_info_t heap = {};
+  heap.size = sizeof(heap);
+  HAL_Core_Runtime_Info(&heap, nullptr);
+  if (heap.freeheap < memStats.get_minFreeHeap(state)) memStats.set_minFreeHeap(state, heap.freeheap);
+  if (heap.largest_free_block_heap < memStats.get_minLargestBlock(state)) memStats.set_minLargestBlock(state, heap.largest_free_block_heap);
+
+  StackSample stacks;
+  stacks.applicationThread = os_thread_current(nullptr);           // Only ever called from the application thread
+  for (uint8_t thread = 0; thread < memStatsData::NUM_THREADS; thread++) stacks.freeStack[thread] = memStatsData::NOT_SAMPLED;
+  os_thread_dump(OS_THREAD_INVALID_HANDLE, threadDumpCallback, &stacks);
+
+  for (uint8_t thread = 0; thread < memStatsData::NUM_THREADS; thread++) {
+    if (stacks.freeStack[thread] < memStats.get_minFreeStack(thread)) {
+      memStats.set_minFreeStack(thread, stacks.freeStack[thread]);
+      memStats.set_minStackState(thread, state);
+    }
+  }
+}
+
+void Memory_Stats::dailyReport() {
+  char data[384];
+  size_t len;
+
+  // One entry per state for the heap, one per thread for the stacks
+  len = snprintf(data, sizeof(data), "{\"heap\":[");
+  for (uint8_t state = 0; state < memStatsData::NUM_STATES; state++) len = appendMinimum(data, len, sizeof(data), state == 0, memStats.get_minFreeHeap(state));
+  if (len < sizeof(data)) len += snprintf(&data[len], sizeof(data) - len, "],\"block\":[");
+  for (uint8_t state = 0; state < memStatsData::NUM_STATES; state++) len = appendMinimum(data, len, sizeof(data), state == 0, memStats.get_minLargestBlock(state));
+  if (len < sizeof(data)) len += snprintf(&data[len], sizeof(data) - len, "],\"stack\":[");
+  for (uint8_t thread = 0; thread < memStatsData::NUM_THREADS; thread++) len = appendMinimum(data, len, sizeof(data), thread == 0, memStats.get_minFreeStack(thread));
+  if (len < sizeof(data)) len += snprintf(&data[len], sizeof(data) - len, "],\"stackstate\":[");
+  for (uint8_t thread = 0; thread < memStatsData::NUM_THREADS && len < sizeof(data); thread++) {
+    len += snprintf(&data[len], sizeof(data) - len, "%s%u", (thread == 0) ? "" : ",", memStats.get_minStackState(thread));
+  }
+
+  if (len < sizeof(data)) {
+    snprintf(&data[len], sizeof(data) - len, "],\"timestamp\":%lu000}", Time.now());
+    PublishQueuePosix::instance().publish("memStats", data, PRIVATE | WITH_ACK);
+  }
+  else Log.info("Memory statistics too large to publish");
+
+  memStats.initialize();                                          // Start a new day
+  memStats.flush(true);
+}
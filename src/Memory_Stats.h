@@ -0,0 +1,114 @@
+/*
+ * @file Memory_Stats.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Keeps the lowest free heap, the smallest largest free block and thread stack high water marks in FRAM -
+ * each tagged by the state machine state - and reports them once a day
+ *
+ * @version 0.1
+ * @date 2023-05-20
+ *
+ */
+
+#ifndef __MEMORY_STATS_H
+#define __MEMORY_STATS_H
+
+#include "Particle.h"
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * From global application setup you must call:
+ * Memory_Stats::instance().setup();
+ *
+ * From global application loop you must call:
+ * Memory_Stats::instance().loop();
+ */
+class Memory_Stats {
+public:
+    /**
+     * @brief The threads whose stacks we watch - also the index into memStats.minFreeStack
+     *
+     */
+    enum ThreadIndex : uint8_t {
+        THREAD_APPLICATION,
+        THREAD_SYSTEM,
+        THREAD_PUBLISH                                  // BackgroundPublish, behind PublishQueuePosix
+    };
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use Memory_Stats::instance() to instantiate the singleton.
+     */
+    static Memory_Stats &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     *
+     * You typically use Memory_Stats::instance().setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     *
+     * @details Samples once a second while we are awake
+     *
+     * You typically use Memory_Stats::instance().loop();
+     */
+    void loop();
+
+    /**
+     * @brief Samples for the state we are leaving, then tags later samples with the state we are entering
+     *
+     */
+    void recordTransition(uint8_t from, uint8_t to);
+
+    /**
+     * @brief Queues the day's low water marks as a "memStats" event and starts a new day
+     *
+     * @details Called from dailyCleanup() - the event goes out with the first connection
+     *
+     */
+    void dailyReport();
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use Memory_Stats::instance() to instantiate the singleton.
+     */
+    Memory_Stats();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~Memory_Stats();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Memory_Stats(const Memory_Stats&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Memory_Stats& operator=(const Memory_Stats&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static Memory_Stats *_instance;
+
+    /**
+     * @brief Reads the heap and thread stacks and lowers the minimums for state
+     *
+     */
+    void sample(uint8_t state);
+
+    uint8_t currentState = 0;                           // Samples are tagged with this
+    unsigned long lastSampleMillis = 0;
+};
+#endif  /* __MEMORY_STATS_H */
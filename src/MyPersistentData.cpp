@@ -6,6 +6,19 @@
 
 MB85RC64 fram(Wire, 0);
 
+// FRAM map (MB85RC64 - 8k bytes) - each object must stay inside its slot as fields are added
+// 0    - sysStatus
+// 100  - current
+// 200  - alertStatus
+// 400  - logStatus
+// 512  - stateStats
+// 768  - tofCal
+// 832  - tzConfig
+// 896  - memStats
+// 1024 - dailyStats
+// 4096 - Binary_Log record ring (to the end of the FRAM)
+// The resume checkpoint is in retained RAM, not FRAM
+
 // *******************  SysStatus Storage Object **********************
 //
 // ********************************************************************
@@ -70,7 +83,7 @@ void sysStatusData::initialize() {
     PersistentDataFRAM::initialize();
 
     const char message[26] = "Loading System Defaults";
-    Log.info(message);
+    Log.info("%s", message);
     if (Particle.connected()) Particle.publish("Mode",message, PRIVATE);
     sysStatus.set_trashFull(9);
     sysStatus.set_trashEmpty(38);
@@ -188,6 +201,54 @@ void sysStatusData::set_trashEmpty(int value) {
     setValue<int>(offsetof(SysData, trashEmpty), value);
 }   
 
+bool sysStatusData::get_tofAutonomous() const {
+    return getValue<bool>(offsetof(SysData,tofAutonomous));
+}
+
+void sysStatusData::set_tofAutonomous(bool value) {
+    setValue<bool>(offsetof(SysData, tofAutonomous), value);
+}
+
+uint8_t sysStatusData::get_tofFusion() const {
+    return getValue<uint8_t>(offsetof(SysData,tofFusion));
+}
+
+void sysStatusData::set_tofFusion(uint8_t value) {
+    setValue<uint8_t>(offsetof(SysData, tofFusion), value);
+}
+
+time_t sysStatusData::get_rtcSetTime() const {
+    return getValue<time_t>(offsetof(SysData,rtcSetTime));
+}
+
+void sysStatusData::set_rtcSetTime(time_t value) {
+    setValue<time_t>(offsetof(SysData, rtcSetTime), value);
+}
+
+float sysStatusData::get_rtcDriftPpm() const {
+    return getValue<float>(offsetof(SysData,rtcDriftPpm));
+}
+
+void sysStatusData::set_rtcDriftPpm(float value) {
+    setValue<float>(offsetof(SysData, rtcDriftPpm), value);
+}
+
+uint8_t sysStatusData::get_connectFailures() const {
+    return getValue<uint8_t>(offsetof(SysData,connectFailures));
+}
+
+void sysStatusData::set_connectFailures(uint8_t value) {
+    setValue<uint8_t>(offsetof(SysData, connectFailures), value);
+}
+
+time_t sysStatusData::get_nextConnectTime() const {
+    return getValue<time_t>(offsetof(SysData,nextConnectTime));
+}
+
+void sysStatusData::set_nextConnectTime(time_t value) {
+    setValue<time_t>(offsetof(SysData, nextConnectTime), value);
+}
+
 // *****************  Current Status Storage Object *******************
 // 
 // ********************************************************************
@@ -214,15 +275,48 @@ void currentStatusData::setup() {
     //    .withLogData(true)
         .withSaveDelayMs(250)
         .load();
+
+    Measurement reading;                                                  // Readers see what was saved until the first new measurement
+    WITH_LOCK(*this) {
+        reading.trashHeight = currentData.trashHeight;
+        reading.percentFull = currentData.percentFull;
+        reading.lastMeasureTime = currentData.lastMeasureTime;
+        reading.trashcanEmptied = currentData.trashcanEmptied;
+        reading.internalTempC = currentData.internalTempC;
+        reading.lidPosition = currentData.lidPosition;
+        reading.batteryVoltage = currentData.batteryVoltage;
+    }
+    snapshot.write(reading);
 }
 
 void currentStatusData::loop() {
     current.flush(false);
 }
 
+Measurement currentStatusData::measurement() const {
+    Measurement reading;
+    while (!snapshot.tryRead(reading)) delay(1);                          // Overlapped a commit - let the writer's thread finish it
+    return reading;
+}
+
+void currentStatusData::commitMeasurement(const Measurement &reading) {
+    snapshot.write(reading);
+    WITH_LOCK(*this) {
+        currentData.trashHeight = reading.trashHeight;
+        currentData.percentFull = reading.percentFull;
+        currentData.lastMeasureTime = reading.lastMeasureTime;
+        currentData.trashcanEmptied = reading.trashcanEmptied;
+        currentData.internalTempC = reading.internalTempC;
+        currentData.lidPosition = reading.lidPosition;
+        currentData.batteryVoltage = reading.batteryVoltage;
+        updateHash();                                                     // Marks the record for the next deferred save
+    }
+}
+
 void currentStatusData::resetEverything() {                             // The device is waking up in a new day or is a new install
   sysStatus.set_resetCount(0);                                          // Reset the reset count as well
   current.set_alertCode(0);
+  current.set_lidActivity(0);
 }
 
 
@@ -313,3 +407,585 @@ void currentStatusData::set_batteryVoltage(float value) {
     setValue<float>(offsetof(CurrentData, batteryVoltage), value);
 }
 
+uint16_t currentStatusData::get_lidActivity() const  {
+    return getValue<uint16_t>(offsetof(CurrentData,lidActivity));
+}
+void currentStatusData::set_lidActivity(uint16_t value) {
+    setValue<uint16_t>(offsetof(CurrentData, lidActivity), value);
+}
+
+
+
+// *****************  Alert History Storage Object ********************
+// 
+// ********************************************************************
+
+alertStatusData *alertStatusData::_instance;
+
+// [static]
+alertStatusData &alertStatusData::instance() {
+    if (!_instance) {
+        _instance = new alertStatusData();
+    }
+    return *_instance;
+}
+
+alertStatusData::alertStatusData() : StorageHelperRK::PersistentDataFRAM(::fram, 200, &alertData.alertHeader, sizeof(AlertData), ALERT_DATA_MAGIC, ALERT_DATA_VERSION) {
+};
+
+alertStatusData::~alertStatusData() {
+}
+
+void alertStatusData::setup() {
+    fram.begin();
+    alertStatus
+    //    .withLogData(true)
+        .withSaveDelayMs(250)
+        .load();
+}
+
+void alertStatusData::loop() {
+    alertStatus.flush(false);
+}
+
+void alertStatusData::initialize() {
+    PersistentDataFRAM::initialize();                                   // Zeros the counts, steps and timestamps
+
+    Log.info("Alert History Initialized");
+
+    // If you manually update fields here, be sure to update the hash
+    updateHash();
+}
+
+uint16_t alertStatusData::get_occurrences(uint8_t index) const {
+    if (index >= ALERT_HISTORY_SIZE) return 0;
+    return getValue<uint16_t>(offsetof(AlertData, occurrences) + index * sizeof(uint16_t));
+}
+
+void alertStatusData::set_occurrences(uint8_t index, uint16_t value) {
+    if (index >= ALERT_HISTORY_SIZE) return;
+    setValue<uint16_t>(offsetof(AlertData, occurrences) + index * sizeof(uint16_t), value);
+}
+
+uint8_t alertStatusData::get_escalationStep(uint8_t index) const {
+    if (index >= ALERT_HISTORY_SIZE) return 0;
+    return getValue<uint8_t>(offsetof(AlertData, escalationStep) + index * sizeof(uint8_t));
+}
+
+void alertStatusData::set_escalationStep(uint8_t index, uint8_t value) {
+    if (index >= ALERT_HISTORY_SIZE) return;
+    setValue<uint8_t>(offsetof(AlertData, escalationStep) + index * sizeof(uint8_t), value);
+}
+
+time_t alertStatusData::get_lastOccurrence(uint8_t index) const {
+    if (index >= ALERT_HISTORY_SIZE) return 0;
+    return getValue<time_t>(offsetof(AlertData, lastOccurrence) + index * sizeof(time_t));
+}
+
+void alertStatusData::set_lastOccurrence(uint8_t index, time_t value) {
+    if (index >= ALERT_HISTORY_SIZE) return;
+    setValue<time_t>(offsetof(AlertData, lastOccurrence) + index * sizeof(time_t), value);
+}
+
+
+// *****************  Log Ring Status Storage Object ******************
+// 
+// ********************************************************************
+
+logStatusData *logStatusData::_instance;
+
+// [static]
+logStatusData &logStatusData::instance() {
+    if (!_instance) {
+        _instance = new logStatusData();
+    }
+    return *_instance;
+}
+
+logStatusData::logStatusData() : StorageHelperRK::PersistentDataFRAM(::fram, 400, &logData.logHeader, sizeof(LogData), LOG_DATA_MAGIC, LOG_DATA_VERSION) {
+};
+
+logStatusData::~logStatusData() {
+}
+
+void logStatusData::setup() {
+    fram.begin();
+    logStatus
+    //    .withLogData(true)
+        .withSaveDelayMs(1000)
+        .load();
+}
+
+void logStatusData::loop() {
+    logStatus.flush(false);
+}
+
+void logStatusData::initialize() {
+    PersistentDataFRAM::initialize();                                   // Empty ring and no pull in progress
+
+    Log.info("Log Ring Initialized");
+
+    // If you manually update fields here, be sure to update the hash
+    updateHash();
+}
+
+uint32_t logStatusData::get_nextSequence() const {
+    return getValue<uint32_t>(offsetof(LogData, nextSequence));
+}
+
+void logStatusData::set_nextSequence(uint32_t value) {
+    setValue<uint32_t>(offsetof(LogData, nextSequence), value);
+}
+
+uint32_t logStatusData::get_pullCursor() const {
+    return getValue<uint32_t>(offsetof(LogData, pullCursor));
+}
+
+void logStatusData::set_pullCursor(uint32_t value) {
+    setValue<uint32_t>(offsetof(LogData, pullCursor), value);
+}
+
+uint32_t logStatusData::get_pullEnd() const {
+    return getValue<uint32_t>(offsetof(LogData, pullEnd));
+}
+
+void logStatusData::set_pullEnd(uint32_t value) {
+    setValue<uint32_t>(offsetof(LogData, pullEnd), value);
+}
+
+bool logStatusData::get_traceEnabled() const {
+    return getValue<bool>(offsetof(LogData, traceEnabled));
+}
+
+void logStatusData::set_traceEnabled(bool value) {
+    setValue<bool>(offsetof(LogData, traceEnabled), value);
+}
+
+
+// *****************  State Machine Statistics Object *****************
+// 
+// ********************************************************************
+
+stateStatsData *stateStatsData::_instance;
+
+// [static]
+stateStatsData &stateStatsData::instance() {
+    if (!_instance) {
+        _instance = new stateStatsData();
+    }
+    return *_instance;
+}
+
+stateStatsData::stateStatsData() : StorageHelperRK::PersistentDataFRAM(::fram, 512, &statsData.statsHeader, sizeof(StatsData), STATS_DATA_MAGIC, STATS_DATA_VERSION) {
+};
+
+stateStatsData::~stateStatsData() {
+}
+
+void stateStatsData::setup() {
+    fram.begin();
+    stateStats
+    //    .withLogData(true)
+        .withSaveDelayMs(1000)
+        .load();
+}
+
+void stateStatsData::loop() {
+    stateStats.flush(false);
+}
+
+void stateStatsData::initialize() {
+    PersistentDataFRAM::initialize();                                   // Zeros the matrix, histograms and flags
+
+    Log.info("State Statistics Initialized");
+
+    // If you manually update fields here, be sure to update the hash
+    updateHash();
+}
+
+uint16_t stateStatsData::get_transitions(uint8_t from, uint8_t to) const {
+    if (from >= NUM_STATES || to >= NUM_STATES) return 0;
+    return getValue<uint16_t>(offsetof(StatsData, transitions) + (from * NUM_STATES + to) * sizeof(uint16_t));
+}
+
+void stateStatsData::set_transitions(uint8_t from, uint8_t to, uint16_t value) {
+    if (from >= NUM_STATES || to >= NUM_STATES) return;
+    setValue<uint16_t>(offsetof(StatsData, transitions) + (from * NUM_STATES + to) * sizeof(uint16_t), value);
+}
+
+uint16_t stateStatsData::get_dwell(uint8_t state, uint8_t bin) const {
+    if (state >= NUM_STATES || bin >= NUM_DWELL_BINS) return 0;
+    return getValue<uint16_t>(offsetof(StatsData, dwell) + (state * NUM_DWELL_BINS + bin) * sizeof(uint16_t));
+}
+
+void stateStatsData::set_dwell(uint8_t state, uint8_t bin, uint16_t value) {
+    if (state >= NUM_STATES || bin >= NUM_DWELL_BINS) return;
+    setValue<uint16_t>(offsetof(StatsData, dwell) + (state * NUM_DWELL_BINS + bin) * sizeof(uint16_t), value);
+}
+
+uint16_t stateStatsData::get_errorReentries() const {
+    return getValue<uint16_t>(offsetof(StatsData, errorReentries));
+}
+
+void stateStatsData::set_errorReentries(uint16_t value) {
+    setValue<uint16_t>(offsetof(StatsData, errorReentries), value);
+}
+
+uint16_t stateStatsData::get_webhookTimeouts() const {
+    return getValue<uint16_t>(offsetof(StatsData, webhookTimeouts));
+}
+
+void stateStatsData::set_webhookTimeouts(uint16_t value) {
+    setValue<uint16_t>(offsetof(StatsData, webhookTimeouts), value);
+}
+
+uint8_t stateStatsData::get_anomalyFlags() const {
+    return getValue<uint8_t>(offsetof(StatsData, anomalyFlags));
+}
+
+void stateStatsData::set_anomalyFlags(uint8_t value) {
+    setValue<uint8_t>(offsetof(StatsData, anomalyFlags), value);
+}
+
+
+// *****************  TOF Temperature Calibration Object **************
+// 
+// ********************************************************************
+
+tofCalData *tofCalData::_instance;
+
+// [static]
+tofCalData &tofCalData::instance() {
+    if (!_instance) {
+        _instance = new tofCalData();
+    }
+    return *_instance;
+}
+
+tofCalData::tofCalData() : StorageHelperRK::PersistentDataFRAM(::fram, 768, &calData.calHeader, sizeof(CalData), CAL_DATA_MAGIC, CAL_DATA_VERSION) {
+};
+
+tofCalData::~tofCalData() {
+}
+
+void tofCalData::setup() {
+    fram.begin();
+    tofCal
+    //    .withLogData(true)
+        .withSaveDelayMs(1000)
+        .load();
+}
+
+void tofCalData::loop() {
+    tofCal.flush(false);
+}
+
+void tofCalData::initialize() {
+    PersistentDataFRAM::initialize();                                   // No samples yet
+
+    Log.info("TOF Calibration Initialized");
+    tofCal.set_calTempC(NAN);                                           // Forces a temperature update on the first measurement
+
+    // If you manually update fields here, be sure to update the hash
+    updateHash();
+}
+
+float tofCalData::get_calTempC() const {
+    return getValue<float>(offsetof(CalData, calTempC));
+}
+
+void tofCalData::set_calTempC(float value) {
+    setValue<float>(offsetof(CalData, calTempC), value);
+}
+
+tofCalData::Fit tofCalData::get_fit() const {
+    Fit value;
+    WITH_LOCK(*this) {
+        value = calData.fit;
+    }
+    return value;
+}
+
+void tofCalData::set_fit(const Fit &value) {
+    WITH_LOCK(*this) {
+        calData.fit = value;
+        updateHash();
+    }
+}
+
+
+// *****************  Timezone Rule Object ****************************
+// 
+// ********************************************************************
+
+tzConfigData *tzConfigData::_instance;
+
+// [static]
+tzConfigData &tzConfigData::instance() {
+    if (!_instance) {
+        _instance = new tzConfigData();
+    }
+    return *_instance;
+}
+
+tzConfigData::tzConfigData() : StorageHelperRK::PersistentDataFRAM(::fram, 832, &tzData.tzHeader, sizeof(TzData), TZ_DATA_MAGIC, TZ_DATA_VERSION) {
+};
+
+tzConfigData::~tzConfigData() {
+}
+
+void tzConfigData::setup() {
+    fram.begin();
+    tzConfig
+    //    .withLogData(true)
+        .withSaveDelayMs(100)
+        .load();
+}
+
+void tzConfigData::loop() {
+    tzConfig.flush(false);
+}
+
+void tzConfigData::initialize() {
+    PersistentDataFRAM::initialize();                                   // All zero - rule.valid is false
+
+    Log.info("Timezone Rule Initialized");
+
+    // If you manually update fields here, be sure to update the hash
+    updateHash();
+}
+
+// getValue / setValue only handle integral types - the rule is copied as a whole under the same lock
+LocalTimeRule tzConfigData::get_rule() const {
+    LocalTimeRule value;
+    WITH_LOCK(*this) {
+        value = tzData.rule;
+    }
+    return value;
+}
+
+void tzConfigData::set_rule(const LocalTimeRule &value) {
+    WITH_LOCK(*this) {
+        tzData.rule = value;
+        updateHash();
+    }
+}
+
+
+// *****************  Memory Statistics Object ************************
+// 
+// ********************************************************************
+
+memStatsData *memStatsData::_instance;
+
+// [static]
+memStatsData &memStatsData::instance() {
+    if (!_instance) {
+        _instance = new memStatsData();
+    }
+    return *_instance;
+}
+
+memStatsData::memStatsData() : StorageHelperRK::PersistentDataFRAM(::fram, 896, &memData.memHeader, sizeof(MemData), MEM_DATA_MAGIC, MEM_DATA_VERSION) {
+};
+
+memStatsData::~memStatsData() {
+}
+
+void memStatsData::setup() {
+    fram.begin();
+    memStats
+    //    .withLogData(true)
+        .withSaveDelayMs(1000)
+        .load();
+}
+
+void memStatsData::loop() {
+    memStats.flush(false);
+}
+
+void memStatsData::initialize() {
+    PersistentDataFRAM::initialize();
+
+    Log.info("Memory Statistics Initialized");
+    for (uint8_t state = 0; state < NUM_STATES; state++) {             // Nothing sampled yet today
+        memData.minFreeHeap[state] = NOT_SAMPLED;
+        memData.minLargestBlock[state] = NOT_SAMPLED;
+    }
+    for (uint8_t thread = 0; thread < NUM_THREADS; thread++) memData.minFreeStack[thread] = NOT_SAMPLED;
+
+    // If you manually update fields here, be sure to update the hash
+    updateHash();
+}
+
+uint32_t memStatsData::get_minFreeHeap(uint8_t state) const {
+    if (state >= NUM_STATES) return NOT_SAMPLED;
+    return getValue<uint32_t>(offsetof(MemData, minFreeHeap) + state * sizeof(uint32_t));
+}
+
+void memStatsData::set_minFreeHeap(uint8_t state, uint32_t value) {
+    if (state >= NUM_STATES) return;
+    setValue<uint32_t>(offsetof(MemData, minFreeHeap) + state * sizeof(uint32_t), value);
+}
+
+uint32_t memStatsData::get_minLargestBlock(uint8_t state) const {
+    if (state >= NUM_STATES) return NOT_SAMPLED;
+    return getValue<uint32_t>(offsetof(MemData, minLargestBlock) + state * sizeof(uint32_t));
+}
+
+void memStatsData::set_minLargestBlock(uint8_t state, uint32_t value) {
+    if (state >= NUM_STATES) return;
+    setValue<uint32_t>(offsetof(MemData, minLargestBlock) + state * sizeof(uint32_t), value);
+}
+
+uint32_t memStatsData::get_minFreeStack(uint8_t thread) const {
+    if (thread >= NUM_THREADS) return NOT_SAMPLED;
+    return getValue<uint32_t>(offsetof(MemData, minFreeStack) + thread * sizeof(uint32_t));
+}
+
+void memStatsData::set_minFreeStack(uint8_t thread, uint32_t value) {
+    if (thread >= NUM_THREADS) return;
+    setValue<uint32_t>(offsetof(MemData, minFreeStack) + thread * sizeof(uint32_t), value);
+}
+
+uint8_t memStatsData::get_minStackState(uint8_t thread) const {
+    if (thread >= NUM_THREADS) return 0;
+    return getValue<uint8_t>(offsetof(MemData, minStackState) + thread);
+}
+
+void memStatsData::set_minStackState(uint8_t thread, uint8_t value) {
+    if (thread >= NUM_THREADS) return;
+    setValue<uint8_t>(offsetof(MemData, minStackState) + thread, value);
+}
+
+
+// *****************  Daily Aggregates Object *************************
+// 
+// ********************************************************************
+
+dailyStatsData *dailyStatsData::_instance;
+
+// [static]
+dailyStatsData &dailyStatsData::instance() {
+    if (!_instance) {
+        _instance = new dailyStatsData();
+    }
+    return *_instance;
+}
+
+dailyStatsData::dailyStatsData() : StorageHelperRK::PersistentDataFRAM(::fram, 1024, &dailyData.dailyHeader, sizeof(DailyData), DAILY_DATA_MAGIC, DAILY_DATA_VERSION) {
+};
+
+dailyStatsData::~dailyStatsData() {
+}
+
+void dailyStatsData::setup() {
+    fram.begin();
+    dailyStats
+    //    .withLogData(true)
+        .withSaveDelayMs(1000)
+        .load();
+}
+
+void dailyStatsData::loop() {
+    dailyStats.flush(false);
+}
+
+void dailyStatsData::initialize() {
+    PersistentDataFRAM::initialize();                                   // All zero - no samples, no day yet
+
+    Log.info("Daily Aggregates Initialized");
+
+    // If you manually update fields here, be sure to update the hash
+    updateHash();
+}
+
+// getValue / setValue only handle integral types - a sample updates the totals as a whole under one lock and one hash
+dailyStatsData::Aggregates dailyStatsData::get_totals() const {
+    Aggregates value;
+    WITH_LOCK(*this) {
+        value = dailyData.totals;
+    }
+    return value;
+}
+
+void dailyStatsData::set_totals(const Aggregates &value) {
+    WITH_LOCK(*this) {
+        dailyData.totals = value;
+        updateHash();
+    }
+}
+
+
+// *****************  Resume Checkpoint Object (retained RAM) *****************
+// 
+// ****************************************************************************
+
+retained resumeData::ResumeData resumeRetained;                         // Survives System.reset() - the header hash is the integrity check
+
+resumeData *resumeData::_instance;
+
+// [static]
+resumeData &resumeData::instance() {
+    if (!_instance) {
+        _instance = new resumeData();
+    }
+    return *_instance;
+}
+
+resumeData::resumeData() : StorageHelperRK::PersistentDataRetained(&resumeRetained.resumeHeader, sizeof(ResumeData), RESUME_DATA_MAGIC, RESUME_DATA_VERSION) {
+};
+
+resumeData::~resumeData() {
+}
+
+void resumeData::setup() {
+    resumeCheckpoint
+        .withSaveDelayMs(0)                                             // Retained RAM - "saving" only updates the hash
+        .load();
+}
+
+bool resumeData::takeResume(time_t maxAge) {
+    bool resume = get_planned() && System.resetReason() == RESET_REASON_USER && Time.isValid() && Time.now() - get_savedAt() <= maxAge;
+    set_planned(false);                                                 // One shot - a crash loop must take the full path
+    return resume;
+}
+
+void resumeData::arm(uint8_t state, bool sensorsReady) {
+    set_resumeState(state);
+    set_sensorsReady(sensorsReady);
+    set_savedAt(Time.now());
+    set_planned(true);                                                  // Last so a partly written checkpoint is never armed
+}
+
+bool resumeData::get_planned() const {
+    return getValue<uint8_t>(offsetof(ResumeData, planned));
+}
+
+void resumeData::set_planned(bool value) {
+    setValue<uint8_t>(offsetof(ResumeData, planned), value);
+}
+
+uint8_t resumeData::get_resumeState() const {
+    return getValue<uint8_t>(offsetof(ResumeData, resumeState));
+}
+
+void resumeData::set_resumeState(uint8_t value) {
+    setValue<uint8_t>(offsetof(ResumeData, resumeState), value);
+}
+
+bool resumeData::get_sensorsReady() const {
+    return getValue<uint8_t>(offsetof(ResumeData, sensorsReady));
+}
+
+void resumeData::set_sensorsReady(bool value) {
+    setValue<uint8_t>(offsetof(ResumeData, sensorsReady), value);
+}
+
+time_t resumeData::get_savedAt() const {
+    return getValue<time_t>(offsetof(ResumeData, savedAt));
+}
+
+void resumeData::set_savedAt(time_t value) {
+    setValue<time_t>(offsetof(ResumeData, savedAt), value);
+}
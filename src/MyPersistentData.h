@@ -4,14 +4,25 @@
 #include "Particle.h"
 #include "MB85RC256V-FRAM-RK.h"
 #include "StorageHelperRK.h"
+#include "Measurement_Snapshot.h"
+#include "LocalTimeRK.h"
+#include "App_States.h"
 
 //Define external class instances. These are typically declared public in the main .CPP. I wonder if we can only declare it here?
-// extern MB85RC64 fram;
+extern MB85RC64 fram;									// Binary_Log writes its record ring directly
 
 //Macros(#define) to swap out during pre-processing (use sparingly). This is typically used outside of this .H and .CPP file within the main .CPP file or other .CPP files that reference this header file. 
 // This way you can do "data.setup()" instead of "MyPersistentData::instance().setup()" as an example
 #define current currentStatusData::instance()
 #define sysStatus sysStatusData::instance()
+#define alertStatus alertStatusData::instance()
+#define logStatus logStatusData::instance()
+#define stateStats stateStatsData::instance()
+#define resumeCheckpoint resumeData::instance()
+#define tofCal tofCalData::instance()
+#define tzConfig tzConfigData::instance()
+#define memStats memStatsData::instance()
+#define dailyStats dailyStatsData::instance()
 
 /**
  * This class is a singleton; you do not create one as a global, on the stack, or with new.
@@ -89,6 +100,12 @@ public:
 		float firmwareRelease;							  // Point release - helpful in development
 		int trashFull;									  // How many inches will the sensor measure when the trashcan is full
 		int trashEmpty;									  // How many inches will the sensor measure when the trashcan is empty
+		bool tofAutonomous;								  // TOF ranges on its own and interrupts on fill band crossings
+		uint8_t tofFusion;								  // How readings from several TOF sensors are combined - Measure_Trash::TofFusion
+		time_t rtcSetTime;								  // When the AB1805 was last set from the cloud - start of the drift window
+		float rtcDriftPpm;								  // Learned AB1805 drift - positive runs fast
+		uint8_t connectFailures;						  // Consecutive failed connection attempts - drives the backoff
+		time_t nextConnectTime;							  // Hourly reports do not try to connect before this
 	};
 
 	SysData sysData;
@@ -162,6 +179,24 @@ public:
 	int get_trashEmpty() const;
 	void set_trashEmpty(int value);
 
+	bool get_tofAutonomous() const;
+	void set_tofAutonomous(bool value);
+
+	uint8_t get_tofFusion() const;
+	void set_tofFusion(uint8_t value);
+
+	time_t get_rtcSetTime() const;
+	void set_rtcSetTime(time_t value);
+
+	float get_rtcDriftPpm() const;
+	void set_rtcDriftPpm(float value);
+
+	uint8_t get_connectFailures() const;
+	void set_connectFailures(uint8_t value);
+
+	time_t get_nextConnectTime() const;
+	void set_nextConnectTime(time_t value);
+
 	//Members here are internal only and therefore protected
 protected:
     /**
@@ -242,6 +277,21 @@ public:
 	 */
 	void resetEverything();  
 
+	/**
+	 * @brief A consistent copy of the last committed measurement - safe from any thread, never takes the mutex
+	 * 
+	 */
+	Measurement measurement() const;
+
+	/**
+	 * @brief Publishes a complete measurement - application thread only (the single writer)
+	 * 
+	 * @details Updates the snapshot and then copies it into the FRAM record under one lock with one hash update
+	 * and one deferred save, instead of a lock, hash and save per field.
+	 * 
+	 */
+	void commitMeasurement(const Measurement &reading);
+
 	/**
 	 * @brief Validates values and, if valid, checks that data is in the correct range.
 	 * 
@@ -274,6 +324,7 @@ public:
 		uint8_t lidPosition;								// Position of the lid: 0 = Unk, 1 - 4 Side, 5-Rightside up, 6-Upside down
 		uint8_t alertCode;									// Current Alert Code
 		float batteryVoltage;                               // Battery charge level
+		uint16_t lidActivity;								// Lid openings (debounced accelerometer interrupts) today
 	};
 	CurrentData currentData;
 
@@ -329,6 +380,9 @@ public:
 	float get_batteryVoltage() const;
 	void set_batteryVoltage(float value);
 
+	uint16_t get_lidActivity() const;
+	void set_lidActivity(uint16_t value);
+
 
 		//Members here are internal only and therefore protected
 protected:
@@ -361,10 +415,828 @@ protected:
      */
     static currentStatusData *_instance;
 
+    SeqLock<Measurement> snapshot;                  // The measurement fields of currentData - seeded in setup()
+
     //Since these variables are only used internally - They can be private. 
 	static const uint32_t CURRENT_DATA_MAGIC = 0x20a99e74;
 	static const uint16_t CURRENT_DATA_VERSION = 2;
 };
 
 
+
+// *****************  Alert History Storage Object ********************
+//
+// ********************************************************************
+
+class alertStatusData : public StorageHelperRK::PersistentDataFRAM {
+public:
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     * 
+     * Use alertStatusData::instance() to instantiate the singleton.
+     */
+    static alertStatusData &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     * 
+     * You typically use alertStatus.setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     * 
+     * You typically use alertStatus.loop();
+     */
+    void loop();
+
+	/**
+	 * @brief Will reinitialize data if it is found not to be valid
+	 * 
+	 */
+	void initialize();
+
+	static const uint8_t ALERT_HISTORY_SIZE = 16;		// One slot per row in the alert policy table
+
+	class AlertData {
+	public:
+		// This structure must always begin with the header (16 bytes)
+		StorageHelperRK::PersistentDataBase::SavedDataHeader alertHeader;
+		// Your fields go here. Once you've added a field you cannot add fields
+		// (except at the end), insert fields, remove fields, change size of a field.
+		// Doing so will cause the data to be corrupted!
+		uint16_t occurrences[ALERT_HISTORY_SIZE];			// How many times each alert has been resolved
+		uint8_t escalationStep[ALERT_HISTORY_SIZE];			// Where each alert is on its escalation ladder
+		time_t lastOccurrence[ALERT_HISTORY_SIZE];			// When each alert was last resolved - 0 once its ladder starts over
+	};
+	AlertData alertData;
+
+	// 	******************* Get and Set Functions for each variable in the storage object ***********
+	// These are indexed by the row in the alert policy table - out of range indices are ignored
+
+	uint16_t get_occurrences(uint8_t index) const;
+	void set_occurrences(uint8_t index, uint16_t value);
+
+	uint8_t get_escalationStep(uint8_t index) const;
+	void set_escalationStep(uint8_t index, uint8_t value);
+
+	time_t get_lastOccurrence(uint8_t index) const;
+	void set_lastOccurrence(uint8_t index, time_t value);
+
+	//Members here are internal only and therefore protected
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     * 
+     * Use alertStatusData::instance() to instantiate the singleton.
+     */
+    alertStatusData();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~alertStatusData();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    alertStatusData(const alertStatusData&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    alertStatusData& operator=(const alertStatusData&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     * 
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static alertStatusData *_instance;
+
+    //Since these variables are only used internally - They can be private. 
+	static const uint32_t ALERT_DATA_MAGIC = 0x20a99e76;
+	static const uint16_t ALERT_DATA_VERSION = 1;
+};
+
+
+
+// *****************  Log Ring Status Storage Object ******************
+//
+// ********************************************************************
+
+class logStatusData : public StorageHelperRK::PersistentDataFRAM {
+public:
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     * 
+     * Use logStatusData::instance() to instantiate the singleton.
+     */
+    static logStatusData &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     * 
+     * You typically use logStatus.setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     * 
+     * You typically use logStatus.loop();
+     */
+    void loop();
+
+	/**
+	 * @brief Will reinitialize data if it is found not to be valid
+	 * 
+	 */
+	void initialize();
+
+	class LogData {
+	public:
+		// This structure must always begin with the header (16 bytes)
+		StorageHelperRK::PersistentDataBase::SavedDataHeader logHeader;
+		// Your fields go here. Once you've added a field you cannot add fields
+		// (except at the end), insert fields, remove fields, change size of a field.
+		// Doing so will cause the data to be corrupted!
+		uint32_t nextSequence;								// Sequence number of the next record written to the FRAM ring
+		uint32_t pullCursor;								// Next record to send in a log pull
+		uint32_t pullEnd;									// Log pull stops here - 0 = no pull in progress
+		bool traceEnabled;									// Record the raw sensor and connectivity trace messages
+	};
+	LogData logData;
+
+	// 	******************* Get and Set Functions for each variable in the storage object ***********
+
+	uint32_t get_nextSequence() const;
+	void set_nextSequence(uint32_t value);
+
+	uint32_t get_pullCursor() const;
+	void set_pullCursor(uint32_t value);
+
+	uint32_t get_pullEnd() const;
+	void set_pullEnd(uint32_t value);
+
+	bool get_traceEnabled() const;
+	void set_traceEnabled(bool value);
+
+	//Members here are internal only and therefore protected
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     * 
+     * Use logStatusData::instance() to instantiate the singleton.
+     */
+    logStatusData();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~logStatusData();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    logStatusData(const logStatusData&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    logStatusData& operator=(const logStatusData&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     * 
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static logStatusData *_instance;
+
+    //Since these variables are only used internally - They can be private. 
+	static const uint32_t LOG_DATA_MAGIC = 0x20a99e77;
+	static const uint16_t LOG_DATA_VERSION = 1;
+};
+
+
+
+// *****************  State Machine Statistics Object *****************
+//
+// ********************************************************************
+
+class stateStatsData : public StorageHelperRK::PersistentDataFRAM {
+public:
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     * 
+     * Use stateStatsData::instance() to instantiate the singleton.
+     */
+    static stateStatsData &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     * 
+     * You typically use stateStats.setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     * 
+     * You typically use stateStats.loop();
+     */
+    void loop();
+
+	/**
+	 * @brief Will reinitialize data if it is found not to be valid - also used for the daily reset
+	 * 
+	 */
+	void initialize();
+
+	static const uint8_t NUM_STATES = LEAF_STATE_COUNT;	// Leaf states from App_States.h - composite states are never entered on their own
+	static const uint8_t NUM_DWELL_BINS = 6;			// <1s, <10s, <1min, <5min, <30min, longer
+
+	class StatsData {
+	public:
+		// This structure must always begin with the header (16 bytes)
+		StorageHelperRK::PersistentDataBase::SavedDataHeader statsHeader;
+		// Your fields go here. Once you've added a field you cannot add fields
+		// (except at the end), insert fields, remove fields, change size of a field.
+		// Doing so will cause the data to be corrupted!
+		uint16_t transitions[NUM_STATES][NUM_STATES];		// Transition counts [from][to]
+		uint16_t dwell[NUM_STATES][NUM_DWELL_BINS];			// Dwell time histogram for each state
+		uint16_t errorReentries;							// Times we went back to the Error state within 10 minutes of leaving it
+		uint16_t webhookTimeouts;							// Transitions into Error with alert 40 pending
+		uint8_t anomalyFlags;								// See State_Stats.h
+	};
+	StatsData statsData;
+
+	// 	******************* Get and Set Functions for each variable in the storage object ***********
+
+	uint16_t get_transitions(uint8_t from, uint8_t to) const;
+	void set_transitions(uint8_t from, uint8_t to, uint16_t value);
+
+	uint16_t get_dwell(uint8_t state, uint8_t bin) const;
+	void set_dwell(uint8_t state, uint8_t bin, uint16_t value);
+
+	uint16_t get_errorReentries() const;
+	void set_errorReentries(uint16_t value);
+
+	uint16_t get_webhookTimeouts() const;
+	void set_webhookTimeouts(uint16_t value);
+
+	uint8_t get_anomalyFlags() const;
+	void set_anomalyFlags(uint8_t value);
+
+	//Members here are internal only and therefore protected
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     * 
+     * Use stateStatsData::instance() to instantiate the singleton.
+     */
+    stateStatsData();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~stateStatsData();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    stateStatsData(const stateStatsData&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    stateStatsData& operator=(const stateStatsData&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     * 
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static stateStatsData *_instance;
+
+    //Since these variables are only used internally - They can be private. 
+	static const uint32_t STATS_DATA_MAGIC = 0x20a99e78;
+	static const uint16_t STATS_DATA_VERSION = 1;
+};
+
+
+
+// *****************  TOF Temperature Calibration Object **************
+//
+// ********************************************************************
+
+class tofCalData : public StorageHelperRK::PersistentDataFRAM {
+public:
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     * 
+     * Use tofCalData::instance() to instantiate the singleton.
+     */
+    static tofCalData &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     * 
+     * You typically use tofCal.setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     * 
+     * You typically use tofCal.loop();
+     */
+    void loop();
+
+	/**
+	 * @brief Will reinitialize data if it is found not to be valid - forgets the learned correction
+	 * 
+	 */
+	void initialize();
+
+	/**
+	 * @brief Least squares accumulators for error (mm) vs temperature (C) - kept as floats so they can be aged by halving
+	 * 
+	 * @details The error is the raw distance less referenceMm, the raw distance of the first emptied can seen.  Not
+	 * trashEmpty - whole inches would put up to 25mm of rounding into every sample.
+	 */
+	struct Fit {
+		float samples;
+		float sumT;
+		float sumE;
+		float sumTT;
+		float sumTE;
+		float referenceMm;									// Last in CalData so it could be added - 0 until captured
+	};
+
+	class CalData {
+	public:
+		// This structure must always begin with the header (16 bytes)
+		StorageHelperRK::PersistentDataBase::SavedDataHeader calHeader;
+		// Your fields go here. Once you've added a field you cannot add fields
+		// (except at the end), insert fields, remove fields, change size of a field.
+		// Doing so will cause the data to be corrupted!
+		float calTempC;										// Temperature at the last VL53L1X temperature (VHV) update - NAN if never
+		Fit fit;
+	};
+	CalData calData;
+
+	// 	******************* Get and Set Functions for each variable in the storage object ***********
+
+	float get_calTempC() const;
+	void set_calTempC(float value);
+
+	Fit get_fit() const;
+	void set_fit(const Fit &value);
+
+	//Members here are internal only and therefore protected
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     * 
+     * Use tofCalData::instance() to instantiate the singleton.
+     */
+    tofCalData();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~tofCalData();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    tofCalData(const tofCalData&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    tofCalData& operator=(const tofCalData&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     * 
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static tofCalData *_instance;
+
+    //Since these variables are only used internally - They can be private. 
+	static const uint32_t CAL_DATA_MAGIC = 0x20a99e7a;
+	static const uint16_t CAL_DATA_VERSION = 1;
+};
+
+
+
+// *****************  Timezone Rule Object ****************************
+//
+// ********************************************************************
+
+class tzConfigData : public StorageHelperRK::PersistentDataFRAM {
+public:
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     * 
+     * Use tzConfigData::instance() to instantiate the singleton.
+     */
+    static tzConfigData &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     * 
+     * You typically use tzConfig.setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     * 
+     * You typically use tzConfig.loop();
+     */
+    void loop();
+
+	/**
+	 * @brief Will reinitialize data if it is found not to be valid - back to the compiled in timezone
+	 * 
+	 */
+	void initialize();
+
+	class TzData {
+	public:
+		// This structure must always begin with the header (16 bytes)
+		StorageHelperRK::PersistentDataBase::SavedDataHeader tzHeader;
+		// Your fields go here. Once you've added a field you cannot add fields
+		// (except at the end), insert fields, remove fields, change size of a field.
+		// Doing so will cause the data to be corrupted!
+		LocalTimeRule rule;									// Set with the "tz" command - not valid means use the compiled in default
+	};
+	TzData tzData;
+
+	// 	******************* Get and Set Functions for each variable in the storage object ***********
+
+	LocalTimeRule get_rule() const;
+	void set_rule(const LocalTimeRule &value);
+
+	//Members here are internal only and therefore protected
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     * 
+     * Use tzConfigData::instance() to instantiate the singleton.
+     */
+    tzConfigData();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~tzConfigData();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    tzConfigData(const tzConfigData&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    tzConfigData& operator=(const tzConfigData&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     * 
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static tzConfigData *_instance;
+
+    //Since these variables are only used internally - They can be private. 
+	static const uint32_t TZ_DATA_MAGIC = 0x20a99e7b;
+	static const uint16_t TZ_DATA_VERSION = 1;
+};
+
+
+
+// *****************  Memory Statistics Object ************************
+//
+// ********************************************************************
+
+class memStatsData : public StorageHelperRK::PersistentDataFRAM {
+public:
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     * 
+     * Use memStatsData::instance() to instantiate the singleton.
+     */
+    static memStatsData &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     * 
+     * You typically use memStats.setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     * 
+     * You typically use memStats.loop();
+     */
+    void loop();
+
+	/**
+	 * @brief Will reinitialize data if it is found not to be valid - also used for the daily reset
+	 * 
+	 */
+	void initialize();
+
+	static const uint8_t NUM_STATES = stateStatsData::NUM_STATES;
+	static const uint8_t NUM_THREADS = 3;				// Application, system and BackgroundPublish
+	static const uint32_t NOT_SAMPLED = 0xFFFFFFFF;		// Minimums start here each day
+
+	class MemData {
+	public:
+		// This structure must always begin with the header (16 bytes)
+		StorageHelperRK::PersistentDataBase::SavedDataHeader memHeader;
+		// Your fields go here. Once you've added a field you cannot add fields
+		// (except at the end), insert fields, remove fields, change size of a field.
+		// Doing so will cause the data to be corrupted!
+		uint32_t minFreeHeap[NUM_STATES];					// Lowest free heap seen in each state (bytes)
+		uint32_t minLargestBlock[NUM_STATES];				// Smallest largest free block in each state - fragmentation
+		uint32_t minFreeStack[NUM_THREADS];					// Stack high water mark - bytes never used by each thread
+		uint8_t minStackState[NUM_THREADS];					// State we were in when each thread's stack reached its low
+	};
+	MemData memData;
+
+	// 	******************* Get and Set Functions for each variable in the storage object ***********
+
+	uint32_t get_minFreeHeap(uint8_t state) const;
+	void set_minFreeHeap(uint8_t state, uint32_t value);
+
+	uint32_t get_minLargestBlock(uint8_t state) const;
+	void set_minLargestBlock(uint8_t state, uint32_t value);
+
+	uint32_t get_minFreeStack(uint8_t thread) const;
+	void set_minFreeStack(uint8_t thread, uint32_t value);
+
+	uint8_t get_minStackState(uint8_t thread) const;
+	void set_minStackState(uint8_t thread, uint8_t value);
+
+	//Members here are internal only and therefore protected
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     * 
+     * Use memStatsData::instance() to instantiate the singleton.
+     */
+    memStatsData();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~memStatsData();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    memStatsData(const memStatsData&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    memStatsData& operator=(const memStatsData&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     * 
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static memStatsData *_instance;
+
+    //Since these variables are only used internally - They can be private. 
+	static const uint32_t MEM_DATA_MAGIC = 0x20a99e7c;
+	static const uint16_t MEM_DATA_VERSION = 1;
+};
+
+
+
+// *****************  Daily Aggregates Object *************************
+//
+// ********************************************************************
+
+class dailyStatsData : public StorageHelperRK::PersistentDataFRAM {
+public:
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     * 
+     * Use dailyStatsData::instance() to instantiate the singleton.
+     */
+    static dailyStatsData &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     * 
+     * You typically use dailyStats.setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     * 
+     * You typically use dailyStats.loop();
+     */
+    void loop();
+
+	/**
+	 * @brief Will reinitialize data if it is found not to be valid - also used to start each day
+	 * 
+	 */
+	void initialize();
+
+	/**
+	 * @brief The running totals for one local day - each sample folds in without looking back at earlier ones
+	 * 
+	 */
+	struct Aggregates {
+		uint32_t day;										// Local date these cover - YYYYMMDD, 0 until the first sample
+		uint16_t samples;									// Measurements folded in
+		uint16_t emptiedCount;
+		float minFill;										// Percent full
+		float maxFill;
+		float sumFill;										// Mean is sumFill / samples
+		uint32_t secondsAbove75;							// Time weighted - each sample's level holds until the next one
+		uint32_t secondsAbove90;
+		uint32_t lidOffSeconds;								// Lid not rightside up
+		float minBattery;									// Volts
+		uint32_t connectSeconds;							// Radio on and connecting - failed attempts count too
+		time_t lastSampleTime;								// Start of the interval the next sample will credit
+		float lastFill;
+		uint8_t lastLidPosition;
+	};
+
+	class DailyData {
+	public:
+		// This structure must always begin with the header (16 bytes)
+		StorageHelperRK::PersistentDataBase::SavedDataHeader dailyHeader;
+		// Your fields go here. Once you've added a field you cannot add fields
+		// (except at the end), insert fields, remove fields, change size of a field.
+		// Doing so will cause the data to be corrupted!
+		Aggregates totals;
+	};
+	DailyData dailyData;
+
+	// 	******************* Get and Set Functions for each variable in the storage object ***********
+
+	Aggregates get_totals() const;
+	void set_totals(const Aggregates &value);
+
+	//Members here are internal only and therefore protected
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     * 
+     * Use dailyStatsData::instance() to instantiate the singleton.
+     */
+    dailyStatsData();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~dailyStatsData();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    dailyStatsData(const dailyStatsData&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    dailyStatsData& operator=(const dailyStatsData&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     * 
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static dailyStatsData *_instance;
+
+    //Since these variables are only used internally - They can be private. 
+	static const uint32_t DAILY_DATA_MAGIC = 0x20a99e7d;
+	static const uint16_t DAILY_DATA_VERSION = 1;
+};
+
+
+
+// *****************  Resume Checkpoint Object (retained RAM) *****************
+//
+// ****************************************************************************
+
+class resumeData : public StorageHelperRK::PersistentDataRetained {
+public:
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     * 
+     * Use resumeData::instance() to instantiate the singleton.
+     */
+    static resumeData &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup() before anything else
+     * 
+     * You typically use resumeCheckpoint.setup();
+     */
+    void setup();
+
+	/**
+	 * @brief Was the last reset one we planned with a valid checkpoint - one shot, disarms the checkpoint
+	 * 
+	 * @param maxAge Seconds - an older checkpoint is ignored
+	 */
+	bool takeResume(time_t maxAge);
+
+	/**
+	 * @brief Arms the checkpoint - call just before a deliberate System.reset()
+	 * 
+	 * @param state Where the state machine should start after the reset
+	 * @param sensorsReady The sensors are up and configured so setup() can skip their bring-up
+	 */
+	void arm(uint8_t state, bool sensorsReady);
+
+	class ResumeData {
+	public:
+		// This structure must always begin with the header (16 bytes)
+		StorageHelperRK::PersistentDataBase::SavedDataHeader resumeHeader;
+		// Your fields go here. Once you've added a field you cannot add fields
+		// (except at the end), insert fields, remove fields, change size of a field.
+		// Doing so will cause the data to be corrupted!
+		uint8_t planned;									// Set just before a deliberate reset, cleared on the next boot
+		uint8_t resumeState;								// State to start in after the reset
+		uint8_t sensorsReady;								// Sensors were up and configured when we reset
+		time_t savedAt;										// Time.now() when the checkpoint was armed
+	};
+	// The ResumeData itself is a retained global in MyPersistentData.cpp - not a member
+
+	// 	******************* Get and Set Functions for each variable in the storage object ***********
+
+	bool get_planned() const;
+	void set_planned(bool value);
+
+	uint8_t get_resumeState() const;
+	void set_resumeState(uint8_t value);
+
+	bool get_sensorsReady() const;
+	void set_sensorsReady(bool value);
+
+	time_t get_savedAt() const;
+	void set_savedAt(time_t value);
+
+	//Members here are internal only and therefore protected
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     * 
+     * Use resumeData::instance() to instantiate the singleton.
+     */
+    resumeData();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~resumeData();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    resumeData(const resumeData&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    resumeData& operator=(const resumeData&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     * 
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static resumeData *_instance;
+
+    //Since these variables are only used internally - They can be private. 
+	static const uint32_t RESUME_DATA_MAGIC = 0x20a99e79;
+	static const uint16_t RESUME_DATA_VERSION = 1;
+};
+
+
 #endif  /* __MYPERSISTENTDATA_H */
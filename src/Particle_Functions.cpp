@@ -3,6 +3,11 @@
 #include "Take_Measurements.h"
 #include "MyPersistentData.h"
 #include "Particle_Functions.h"
+#include "Event_Payload.h"
+#include "Alert_Handling.h"
+#include "Binary_Log.h"
+#include "Measure_Trash.h"
+#include "Benchmark.h"
 #include "JsonParserGeneratorRK.h"
 #include "PublishQueuePosixRK.h"
 #include "LocalTimeRK.h"
@@ -22,6 +27,26 @@ LocalTimeConvert conv;								// For determining if the park should be opened or
 // Battery conect information - https://docs.particle.io/reference/device-os/firmware/boron/#batterystate-
 const char* batteryContext[7] = {"Unknown","Not Charging","Charging","Charged","Discharging","Fault","Diconnected"};
 
+const time_t snapshotMaxAge = 5*60;                   // Commands answer from a measurement younger than this (seconds) without measuring
+
+// Parsed by the compiler - used until a "tz" command stores another rule in FRAM
+constexpr LocalTimeRule defaultTimezone = LocalTimeRule::parse("EST5EDT,M3.2.0/2:00:00,M11.1.0/2:00:00");     // East coast of the US
+static_assert(defaultTimezone.valid, "defaultTimezone is not a valid Posix timezone");
+
+namespace {
+  // getValueByKey() silently truncates into a char buffer - this copies the value and says whether all of it fit.
+  // A missing key is an empty string, as with getValueByKey().
+  bool commandValue(const JsonParser &jp, const JsonParserGeneratorRK::jsmntok_t *container, const char *key, char *result, size_t resultLen) {
+    const JsonParserGeneratorRK::jsmntok_t *value;
+
+    result[0] = 0;
+    if (!jp.getValueTokenByKey(container, key, value)) return true;
+    size_t len = resultLen;
+    jp.getTokenValue(value, result, len);                             // Sets len to what the whole value needed
+    return len <= resultLen;
+  }
+}
+
 Particle_Functions *Particle_Functions::_instance;
 
 // [static]
@@ -41,30 +66,61 @@ Particle_Functions::~Particle_Functions() {
 void Particle_Functions::setup() {
     Log.info("Initializing Particle functions and variables");     // Note: Don't have to be connected but these functions need to in first 30 seconds
     Particle.function("Commands", &Particle_Functions::jsonFunctionParser, this);
+}
 
-    // Setup local time and set the publishing schedule
-	  LocalTime::instance().withConfig(LocalTimePosixTimezone("EST5EDT,M3.2.0/2:00:00,M11.1.0/2:00:00"));			// East coast of the US
-	  conv.withCurrentTime().convert();  	
+void Particle_Functions::applyTimezone() {
+    LocalTimeRule rule = tzConfig.get_rule();
+    if (!rule.valid) rule = defaultTimezone;
+    LocalTimePosixTimezone timezone(rule);
+    LocalTime::instance().withConfig(timezone);
+    conv.withConfig(timezone).withCurrentTime().convert();              // conv keeps its own copy once it has converted
+    Log.info("Timezone is %s%s%s", rule.standardName, (rule.hasDST()) ? "/" : "", rule.dstName);
 }
 
 
 void Particle_Functions::loop() {
-    // Put your code to run during the application thread loop here
+    // Set by the function handlers on the system thread - exchange() takes each request so one made meanwhile is not cleared
+    if (timezoneChanged.exchange(false)) applyTimezone();
+
+    if (measureRequested.exchange(false)) {
+      Take_Measurements::instance().takeMeasurements();
+      if (statusRequested.exchange(false)) publishStatus(longStatusRequested);
+    }
+    if (sendRequested.exchange(false)) sendEvent();
+}
+
+void Particle_Functions::publishStatus(bool longStatus) {
+  char data[160];
+
+  Measurement reading = current.measurement();                        // One consistent copy - may be called while a measurement is committed
+  int age = (int)((Time.now() - reading.lastMeasureTime) / 60);
+  snprintf(data, sizeof(data),"Height: %d\" and %4.2f%% full.  Lid is %s and battery is %4.2fV - measured %d min ago",reading.trashHeight, reading.percentFull, (reading
+    .lidPosition == 1) ? "on its side" : (reading.lidPosition == 5) ? "right side up" : "upside down", reading.batteryVoltage, age);
+  Log.info("%s", data);
+  Particle.publish("status",data,PRIVATE);
+  if (longStatus) {
+    char timeStr[16];
+    conv.withCurrentTime().convert();  	
+    conv.format("%I:%M:%S%p", timeStr, sizeof(timeStr));
+    snprintf(data,sizeof(data),"Time: %s, open: %d, close: %d, mode %s, release %4.2f", timeStr, sysStatus.get_openTime(), sysStatus.get_closeTime(), (sysStatus.get_lowPowerMode()) ? "low power":"not low power", sysStatus.get_firmwareRelease());
+    Log.info("%s", data);
+    Particle.publish("status",data,PRIVATE);
+  }
 }
 
 int Particle_Functions::jsonFunctionParser(String command) {
     // const char * const commandString = "{\"cmd\":[{\"var\":\"hourly\",\"fn\":\"reset\"},{\"var\":1,\"fn\":\"lowpowermode\"},{\"var\":\"daily\",\"fn\":\"report\"}]}";
     // String to put into Uber command window {"cmd":[{"node":1,"var":"hourly","fn":"reset"},{"node":0,"var":1,"fn":"lowpowermode"},{"node":2,"var":"daily","fn":"report"}]}
 
-	String variable;
-	String function;
+	char variable[64];                                                   // Long enough for a Posix timezone rule
+	char function[16];
   char * pEND;
   char messaging[64]=" ";
   bool success = true;
 
 	JsonParserStatic<1024, 80> jp;	// Global parser that supports up to 256 bytes of data and 20 tokens
 
-  Log.info(command.c_str());
+  Log.info("%s", command.c_str());
 
 	jp.clear();
 	jp.addString(command);
@@ -84,56 +140,137 @@ int Particle_Functions::jsonFunctionParser(String command) {
       if (i == 0) return 0;                                       // No valid entries
 			else break;								                    // Ran out of entries 
 		} 
-		jp.getValueByKey(cmdObjectContainer, "var", variable);
-		jp.getValueByKey(cmdObjectContainer, "fn", function);
+		bool fits = commandValue(jp, cmdObjectContainer, "var", variable, sizeof(variable));   // Into our buffers - no String allocations
+		fits = commandValue(jp, cmdObjectContainer, "fn", function, sizeof(function)) && fits;
 
     // In this section we will parse and execute the commands from the console or JSON - assumes connection to Particle
     // ****************  Note: currently there is no valudiation on the nodeNumbers ***************************
-    if (function == "restart") {
+    if (!fits) {                                                     // Never act on a truncated name or value
+      snprintf(messaging,sizeof(messaging),"Invalid: fn over %u or var over %u characters", (unsigned)sizeof(function) - 1, (unsigned)sizeof(variable) - 1);
+      success = false;
+    }
+    else if (!strcmp(function, "restart")) {
       // Format - function - restart, variable - either "soft" or "hard"
       // Test - {"cmd":[{"var":"soft","fn":"restart"}]}
-      if (variable == "soft") {
+      if (!strcmp(variable, "soft")) {
         snprintf(messaging, sizeof(messaging),"Soft reset in 30 seconds");
-        current.set_alertCode(2);
+        Alert_Handling::instance().raiseAlert(2);
       }
-      else if (variable == "hard") {
+      else if (!strcmp(variable, "hard")) {
         snprintf(messaging,sizeof(messaging),"Hard reset in 30 seconds");
-        current.set_alertCode(3);
+        Alert_Handling::instance().raiseAlert(3);
       }
       else snprintf(messaging,sizeof(messaging),"Invalid: soft or hard");
     }
 
     // Report on status
-    else if (function == "status") {
-      char data[128];
+    else if (!strcmp(function, "status")) {
       // Format - function - status, variables - short, long
       // Test - {"cmd":[{"var":"short", "fn":"status"}]}
-      Take_Measurements::instance().takeMeasurements();
-      snprintf(data, sizeof(data),"Height: %d\" and %4.2f%% full.  Lid is %s and battery is %4.2fV",current.get_trashHeight(), current.get_percentFull(), (current
-    .get_lidPosition() == 1) ? "on its side" : (current.get_lidPosition() == 5) ? "right side up" : "upside down", current.get_batteryVoltage());
-      Log.info(data);
-      Particle.publish("status",data,PRIVATE);
-      if (variable == "long") {
-        conv.withCurrentTime().convert();  	
-        snprintf(data,sizeof(data),"Time: %s, open: %d, close: %d, mode %s, release %4.2f", conv.format("%I:%M:%S%p").c_str(), sysStatus.get_openTime(), sysStatus.get_closeTime(), (sysStatus.get_lowPowerMode()) ? "low power":"not low power", sysStatus.get_firmwareRelease());
-        Log.info(data);
-        Particle.publish("status",data,PRIVATE);
+      if (Time.now() - current.measurement().lastMeasureTime <= snapshotMaxAge) publishStatus(!strcmp(variable, "long"));
+      else {                                                          // Stale - the main loop measures and then publishes
+        longStatusRequested = (!strcmp(variable, "long"));
+        statusRequested = true;
+        measureRequested = true;
+        snprintf(messaging,sizeof(messaging),"Measuring - status will follow");
       }
     }
 
     // Command to send data
-    else if (function == "send") {
+    else if (!strcmp(function, "send")) {
       // Format - function - send, variables - NA
       // Test - {"cmd":[{"var":"","fn":"send"}]}
-      Take_Measurements::instance().takeMeasurements();
-      Particle_Functions::sendEvent();
+      if (Time.now() - current.measurement().lastMeasureTime > snapshotMaxAge) measureRequested = true;
+      sendRequested = true;                                           // Sent from the main loop - after measuring if the last one is stale
+      snprintf(messaging,sizeof(messaging),"Sending %s measurement", (measureRequested) ? "a new" : "the last");
+    }
+
+    // Pull the persistent log back to the cloud
+    else if (!strcmp(function, "log")) {
+      // Format - function - log, variables - "resume" or the sequence number to start from
+      // Test - {"cmd":[{"var":"resume","fn":"log"}]}
+      long start = (!strcmp(variable, "resume") || variable[0] == 0) ? -1 : strtol(variable,&pEND,10);
+      snprintf(messaging,sizeof(messaging),"Sending log from record %lu", (unsigned long)Binary_Log::instance().requestPull(start));
+    }
+
+    // Time the measurement and reporting pipeline - results go to the serial log
+    else if (!strcmp(function, "bench")) {
+      // Format - function - bench, variables - iterations (1-100)
+      // Test - {"cmd":[{"var":"20","fn":"bench"}]}
+      int tempValue = strtol(variable,&pEND,10);
+      if ((tempValue >= 1) && (tempValue <= Benchmark::MAX_ITERATIONS)) {
+        snprintf(messaging,sizeof(messaging),"Running benchmark with %d iterations", tempValue);
+        Benchmark::instance().requestRun(tempValue);
+      }
+      else {
+        snprintf(messaging,sizeof(messaging),"Iterations - must be 1-%d", Benchmark::MAX_ITERATIONS);
+        success = false;
+      }
+    }
+
+    // Record the raw sensor and connectivity trace in the log
+    else if (!strcmp(function, "trace")) {
+      // Format - function - trace, variables - on or off
+      // Test - {"cmd":[{"var":"on","fn":"trace"}]}
+      if (!strcmp(variable, "on")) {
+        snprintf(messaging,sizeof(messaging),"Tracing sensor and connectivity inputs");
+        Binary_Log::instance().setTracing(true);
+      }
+      else if (!strcmp(variable, "off")) {
+        snprintf(messaging,sizeof(messaging),"Tracing off");
+        Binary_Log::instance().setTracing(false);
+      }
+      else {
+        snprintf(messaging,sizeof(messaging),"Invalid: on or off");
+        success = false;
+      }
+    }
+
+    // TOF ranging mode
+    else if (!strcmp(function, "tof")) {
+      // Format - function - tof, variables - autonomous or ondemand
+      // Test - {"cmd":[{"var":"autonomous","fn":"tof"}]}
+      if (!strcmp(variable, "autonomous")) {
+        snprintf(messaging,sizeof(messaging),"TOF ranging on its own - wakes on fill band changes");
+        sysStatus.set_tofAutonomous(true);
+      }
+      else if (!strcmp(variable, "ondemand")) {
+        snprintf(messaging,sizeof(messaging),"TOF ranging only when we measure");
+        sysStatus.set_tofAutonomous(false);
+      }
+      else {
+        snprintf(messaging,sizeof(messaging),"Invalid: autonomous or ondemand");
+        success = false;
+      }
+    }
+
+    // Combining readings from several TOF sensors
+    else if (!strcmp(function, "fusion")) {
+      // Format - function - fusion, variables - max, median or weighted
+      // Test - {"cmd":[{"var":"median","fn":"fusion"}]}
+      if (!strcmp(variable, "max")) {
+        snprintf(messaging,sizeof(messaging),"Fill level from the fullest of %u TOF sensors", Measure_Trash::instance().tofSensorCount());
+        sysStatus.set_tofFusion(Measure_Trash::FUSION_MAX);
+      }
+      else if (!strcmp(variable, "median")) {
+        snprintf(messaging,sizeof(messaging),"Fill level from the median of %u TOF sensors", Measure_Trash::instance().tofSensorCount());
+        sysStatus.set_tofFusion(Measure_Trash::FUSION_MEDIAN);
+      }
+      else if (!strcmp(variable, "weighted")) {
+        snprintf(messaging,sizeof(messaging),"Fill level weighted by signal over %u TOF sensors", Measure_Trash::instance().tofSensorCount());
+        sysStatus.set_tofFusion(Measure_Trash::FUSION_WEIGHTED);
+      }
+      else {
+        snprintf(messaging,sizeof(messaging),"Invalid: max, median or weighted");
+        success = false;
+      }
     }
 
     // Stay Connected
-    else if (function == "stay") {
+    else if (!strcmp(function, "stay")) {
       // Format - function - rpt, variables - true or false
       // Test - {"cmd":[{"var":"true","fn":"stay"}]}
-      if (variable == "true") {
+      if (!strcmp(variable, "true")) {
         snprintf(messaging,sizeof(messaging),"Going to keep the device online");
         sysStatus.set_lowPowerMode(false);
       }
@@ -144,7 +281,7 @@ int Particle_Functions::jsonFunctionParser(String command) {
     }
 
     // Setting Open and close hours
-    else if (function == "open") {
+    else if (!strcmp(function, "open")) {
       // Format - function - open, node - 0, variables - 0-12 open hour
       // Test - {"cmd":[{"var":"6","fn":"open"}]}
       int tempValue = strtol(variable,&pEND,10);                       // Looks for the first integer and interprets it
@@ -158,7 +295,7 @@ int Particle_Functions::jsonFunctionParser(String command) {
       }
     }
 
-    else if (function == "close") {
+    else if (!strcmp(function, "close")) {
       // Format - function - close, node - 0, variables - 13-24 open hour
       // Test - {"cmd":[{"var":"21","fn":"close"}]}
       int tempValue = strtol(variable,&pEND,10);                       // Looks for the first integer and interprets it
@@ -172,9 +309,25 @@ int Particle_Functions::jsonFunctionParser(String command) {
       }
     }
     
+    // Set the timezone for opening hours and the daily reset
+    else if (!strcmp(function, "tz")) {
+      // Format - function - tz, variables - a Posix timezone rule or "default"
+      // Test - {"cmd":[{"var":"CST6CDT,M3.2.0/2:00:00,M11.1.0/2:00:00","fn":"tz"}]}
+      LocalTimeRule rule = (!strcmp(variable, "default")) ? LocalTimeRule{} : LocalTimeRule::parse(variable);
+      if (rule.valid || !strcmp(variable, "default")) {
+        snprintf(messaging,sizeof(messaging),"Setting timezone to %s", (rule.valid) ? variable : "the default");
+        tzConfig.set_rule(rule);
+        timezoneChanged = true;                                        // Applied from the main loop - conv is not ours to change here
+      }
+      else {
+        snprintf(messaging,sizeof(messaging),"Invalid: Posix timezone like CST6CDT,M3.2.0,M11.1.0");
+        success = false;
+      }
+    }
+
     // Note - currently the full and empty values are set in the code - not exposed to the console
     /*
-    else if (function == "setFull") {
+    else if (!strcmp(function, "setFull")) {
       // Format - function - setFull, variables - 0-100
       // Test - {"cmd":[{"var":"100","fn":"setFull"}]}
       int tempValue = strtol(variable,&pEND,10);                       // Looks for the first integer and interprets it
@@ -183,7 +336,7 @@ int Particle_Functions::jsonFunctionParser(String command) {
       sysStatus.set_trashFull(tempValue);
     }
 
-    else if (function == "setEmpty")  {
+    else if (!strcmp(function, "setEmpty"))  {
       // Format - function - setEmpty, variables - 0-100
       // Test - {"cmd":[{"var":"100","fn":"setEmpty"}]}
       int tempValue = strtol(variable,&pEND,10);                       // Looks for the first integer and interprets it
@@ -196,12 +349,12 @@ int Particle_Functions::jsonFunctionParser(String command) {
 
     // What if none of these functions are recognized
     else {
-      snprintf(messaging,sizeof(messaging),"%s is not a valid command", function.c_str());
+      snprintf(messaging,sizeof(messaging),"%s is not a valid command", function);
       success = false;
     }
 
     if (!(strncmp(messaging," ",1) == 0)) {
-      Log.info(messaging);
+      Log.info("%s", messaging);
       if (Particle.connected()) Particle.publish("cmd",messaging,PRIVATE);
     }
 
@@ -219,15 +372,21 @@ int Particle_Functions::jsonFunctionParser(String command) {
  */
 void Particle_Functions::sendEvent() {
   char data[256];                                                     // Store the date in this character array - not global
-  unsigned long timeStampValue;                                       // Going to start sending timestamps - and will modify for midnight to fix reporting issue
-  timeStampValue = Time.now()-(Time.minute()*60L+Time.second()+1L);   // Set the timestamp as the last second of the previous hour
 
-  snprintf(data, sizeof(data), "{\"height\":%i, \"percentfull\":%4.2f, \"trashcanemptied\":%d, \"lidposition\":%i, \"battery\":%4.2f, \"temp\":%4.2f, \"resets\":%i, \"alerts\":%i,\"connecttime\":%i,\"timestamp\":%lu000}",current.get_trashHeight(), current.get_percentFull(), current.get_trashcanEmptied(), current.get_lidPosition(), current.get_batteryVoltage(), current.get_internalTempC(), sysStatus.get_resetCount(), current.get_alertCode(), sysStatus.get_lastConnectionDuration(), timeStampValue);
+  buildEventPayload(data, sizeof(data));
   PublishQueuePosix::instance().publish("Ubidots-Measurement-Hook-v1", data, PRIVATE | WITH_ACK);
   Log.info("Ubidots Webhook: %s", data);                              // For monitoring via serial
   current.set_alertCode(0);                                           // Reset the alert after publish
 }
 
+int Particle_Functions::buildEventPayload(char *data, size_t len) {
+  unsigned long timeStampValue;                                       // Going to start sending timestamps - and will modify for midnight to fix reporting issue
+  timeStampValue = Time.now()-(Time.minute()*60L+Time.second()+1L);   // Set the timestamp as the last second of the previous hour - whatever our slot in the report window
+  EventCounters counters = {sysStatus.get_resetCount(), current.get_alertCode(), sysStatus.get_lastConnectionDuration(), current.get_lidActivity(), timeStampValue};
+
+  return formatEventPayload(data, len, current.measurement(), counters);
+}
+
 
 bool Particle_Functions::disconnectFromParticle() {                    // Ensures we disconnect cleanly from Particle
                                                                        // Updated based on this thread: https://community.particle.io/t/waitfor-particle-connected-timeout-does-not-time-out/59181                                                                      		// Updated based on this thread: https://community.particle.io/t/waitfor-particle-connected-timeout-does-not-time-out/59181
@@ -12,6 +12,7 @@
 #define __PARTICLE_FUNCTIONS_H
 
 #include "Particle.h"
+#include <atomic>
 
 /**
  * This class is a singleton; you do not create one as a global, on the stack, or with new.
@@ -41,6 +42,9 @@ public:
     /**
      * @brief Perform application loop operations; call this from global application loop()
      * 
+     * @details Takes the measurements the status and send commands asked for - the commands run on the system
+     * thread so they only schedule the work here
+     * 
      * You typically use Particle_Functions::instance().loop();
      */
     void loop();
@@ -62,6 +66,13 @@ public:
      */
     void sendEvent();
 
+    /**
+     * @brief Builds the Ubidots webhook payload into a caller supplied buffer
+     * 
+     * @returns The snprintf result - the payload length
+     */
+    int buildEventPayload(char *data, size_t len);
+
     /**
      * @brief Disconnects from the Particle network completely
      * 
@@ -80,6 +91,15 @@ public:
      */
     bool meterParticlePublish();
 
+    /**
+     * @brief Sets the local timezone from the rule in tzConfig - or the compiled in default if there is none
+     * 
+     * @details Called from setup() once tzConfig is loaded and from loop() after a "tz" command - no string
+     * parsing is done for the default or a stored rule
+     * 
+     */
+    void applyTimezone();
+
 
 protected:
     /**
@@ -111,5 +131,17 @@ protected:
      */
     static Particle_Functions *_instance;
 
+    /**
+     * @brief Publishes the status command's response from the last measurement in current
+     * 
+     */
+    void publishStatus(bool longStatus);
+
+    std::atomic<bool> measureRequested{false};          // The last measurement is stale - take one on the application thread
+    std::atomic<bool> statusRequested{false};           // Then publish the status
+    std::atomic<bool> longStatusRequested{false};
+    std::atomic<bool> sendRequested{false};             // Then send the webhook
+    std::atomic<bool> timezoneChanged{false};           // A "tz" command stored a new rule
+
 };
 #endif  /* __PARTICLE_FUNCTIONS_H */
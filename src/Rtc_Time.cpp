@@ -0,0 +1,89 @@
+//Particle Functions
+#include "Particle.h"
+#include "MyPersistentData.h"
+#include "AB1805_RK.h"
+#include "LocalTimeRK.h"
+#include "Rtc_Time.h"
+
+extern AB1805 ab1805;                                 // Declared with the watchdog in the main .cpp file
+
+Rtc_Time *Rtc_Time::_instance;
+
+namespace {
+  const time_t minPlausibleTime = 1672531200;                     // 2023-01-01 - older than this firmware
+  const time_t maxRtcAge = 365 * 24 * 3600;                       // A can left powered down longer than this should ask the cloud
+  const time_t minDriftWindow = 2 * 24 * 3600;                    // The RTC reads whole seconds - 2 days keeps that to about 12 ppm
+  const float maxDriftPpm = 200.0;                                // Crystal mode is spec'd at a few ppm, RC mode at a few hundred
+  const float driftWeight = 0.25;                                 // Each new window's share of the learned drift
+}
+
+// [static]
+Rtc_Time &Rtc_Time::instance() {
+  if (!_instance) {
+      _instance = new Rtc_Time();
+  }
+  return *_instance;
+}
+
+Rtc_Time::Rtc_Time() {
+}
+
+Rtc_Time::~Rtc_Time() {
+}
+
+void Rtc_Time::setup() {
+  time_t rtcTime;
+  char timeStr[20];                                                  // Formatted in place - Time.format() would allocate a String
+
+  if (Time.isValid()) return;                                        // Kept across the reset - nothing to do
+  if (!ab1805.detectChip() || !ab1805.isRTCSet() || !ab1805.getRtcAsTime(rtcTime)) {
+    Log.info("RTC not set - need the cloud for the time");
+    return;
+  }
+
+  time_t floor = max(minPlausibleTime, sysStatus.get_lastConnection());
+  if (rtcTime < floor || rtcTime - floor > maxRtcAge) {
+    LocalTime::timeToString(rtcTime, timeStr, sizeof(timeStr));
+    Log.info("RTC time %s is not plausible - need the cloud for the time", timeStr);
+    ab1805.setRegisterBit(AB1805::REG_CTRL_1, AB1805::REG_CTRL_1_WRTC);   // Marks the RTC as not set until the cloud sets it
+    return;
+  }
+
+  time_t corrected = rtcTime;
+  if (sysStatus.get_rtcSetTime() > 0 && rtcTime > sysStatus.get_rtcSetTime()) {
+    corrected -= (time_t)((rtcTime - sysStatus.get_rtcSetTime()) * (double)sysStatus.get_rtcDriftPpm() / 1e6);
+  }
+  Time.setTime(corrected);
+  restored = true;
+  LocalTime::timeToString(corrected, timeStr, sizeof(timeStr));
+  Log.info("Set system clock from RTC %s (%+d sec for %4.1f ppm drift)", timeStr, (int)(corrected - rtcTime), sysStatus.get_rtcDriftPpm());
+}
+
+void Rtc_Time::loop() {
+  system_tick_t syncMillis = Particle.timeSyncedLast();
+  if (syncMillis == 0 || syncMillis == lastSyncMillis || !Time.isValid()) return;
+  lastSyncMillis = syncMillis;
+
+  time_t now = Time.now();
+  time_t rtcTime;
+  time_t window = now - sysStatus.get_rtcSetTime();
+  bool measured = false;
+
+  if (sysStatus.get_rtcSetTime() > 0 && window >= minDriftWindow && ab1805.isRTCSet() && ab1805.getRtcAsTime(rtcTime)) {
+    float ppm = (float)((double)(rtcTime - now) / window * 1e6);
+    if (fabs(ppm) <= maxDriftPpm) {
+      float learned = (sysStatus.get_rtcDriftPpm() == 0.0) ? ppm : sysStatus.get_rtcDriftPpm() * (1.0 - driftWeight) + ppm * driftWeight;
+      sysStatus.set_rtcDriftPpm(learned);
+      Log.info("RTC off by %d sec in %d hours - %4.1f ppm, learned %4.1f ppm", (int)(rtcTime - now), (int)(window / 3600), ppm, learned);
+    }
+    else Log.info("RTC off by %d sec in %d hours - ignored", (int)(rtcTime - now), (int)(window / 3600));
+    measured = true;
+  }
+
+  // Start a new window once this one is measured - or if the library is about to set the RTC anyway
+  if (measured || !syncedThisBoot || sysStatus.get_rtcSetTime() == 0) {
+    ab1805.setRtcFromTime(now);
+    sysStatus.set_rtcSetTime(now);
+  }
+  syncedThisBoot = true;
+}
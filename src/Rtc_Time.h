@@ -0,0 +1,90 @@
+/*
+ * @file Rtc_Time.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Sets the system clock from the AB1805 at boot - corrected for the RTC's learned drift - so a power down
+ * does not cost a cellular connection just to find out what time it is
+ *
+ * @version 0.1
+ * @date 2023-04-29
+ *
+ */
+
+#ifndef __RTC_TIME_H
+#define __RTC_TIME_H
+
+#include "Particle.h"
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ *
+ * From global application setup you must call - before ab1805.setup() so the library does not set the clock first:
+ * Rtc_Time::instance().setup();
+ *
+ * From global application loop you must call - before ab1805.loop() so the drift is measured before the library
+ * resets the RTC on the first time sync after a reset:
+ * Rtc_Time::instance().loop();
+ */
+class Rtc_Time {
+public:
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     *
+     * Use Rtc_Time::instance() to instantiate the singleton.
+     */
+    static Rtc_Time &instance();
+
+    /**
+     * @brief Sets the system clock from the RTC if it has been set and its time is plausible
+     *
+     * @details Plausible is no earlier than our last cloud connection and no more than a year after it.  An
+     * implausible RTC is marked as not set so the AB1805 library does not use it either.
+     */
+    void setup();
+
+    /**
+     * @brief Compares the RTC to the cloud after each time sync and learns its drift in ppm
+     *
+     */
+    void loop();
+
+    /**
+     * @brief Did this boot's system time come from the RTC
+     *
+     */
+    bool restoredFromRtc() const { return restored; }
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     *
+     * Use Rtc_Time::instance() to instantiate the singleton.
+     */
+    Rtc_Time();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~Rtc_Time();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Rtc_Time(const Rtc_Time&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    Rtc_Time& operator=(const Rtc_Time&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     *
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static Rtc_Time *_instance;
+
+    bool restored = false;
+    bool syncedThisBoot = false;                        // The AB1805 library sets the RTC on the first sync after a reset
+    system_tick_t lastSyncMillis = 0;                   // Particle.timeSyncedLast() when we last looked
+};
+#endif  /* __RTC_TIME_H */
@@ -0,0 +1,241 @@
+/*
+ * @file State_Machine.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Table driven hierarchical state machine - entry / tick / exit / event handlers per state, a compile time
+ * event transition table and an interrupt fed event queue.  No Particle dependencies so the application's
+ * state tables can be driven on a Linux host for replay testing.
+ *
+ * @version 0.1
+ * @date 2023-03-18
+ *
+ */
+
+#ifndef __STATE_MACHINE_H
+#define __STATE_MACHINE_H
+
+#include <stdint.h>
+#include "Event_Queue.h"
+
+/**
+ * Usage:
+ *
+ * const MyMachine::StateDef states[NUM_STATES] = {...};          // Indexed by state number
+ * const MyMachine::Transition transitions[] = {...};             // Event driven transitions
+ * MyMachine machine(states, transitions, context);
+ *
+ * From global application setup:
+ * machine.begin(initialState);
+ *
+ * From global application loop:
+ * machine.tick();                                                // Runs the current state's tick handlers
+ * machine.dispatchEvents();                                      // Drains the events posted by the ISRs
+ *
+ * Handlers request a transition with machine.transition(target) - it is taken once the handler returns, the last
+ * request wins and a transition to the current state is ignored.  Transitions are only made to leaf states; the
+ * exit handlers run from the current state up to the common ancestor and the entry handlers run back down.
+ */
+template <typename Context, typename Event, uint8_t NUM_STATES, uint8_t NUM_TRANSITIONS, uint8_t QUEUE_SIZE = 16>
+class StateMachine {
+public:
+    static const uint8_t NO_PARENT = 0xFF;              // Parent of a top level state
+    static const uint8_t ANY_STATE = 0xFE;              // Transition table source that matches every state
+    static const uint8_t NO_TRANSITION = 0xFD;          // Nothing pending
+
+    typedef void (*Action)(Context &context);
+    typedef bool (*EventHandler)(Context &context, const Event &event);      // Return true if the event was handled
+    typedef void (*TransitionHook)(Context &context, uint8_t from, uint8_t to);
+    typedef uint8_t (*EventKey)(const Event &event);                          // What the transition table matches on
+
+    /**
+     * @brief One row per state - any handler can be nullptr
+     *
+     */
+    struct StateDef {
+        uint8_t parent;                                 // NO_PARENT or the enclosing state
+        Action onEntry;
+        Action onTick;                                  // Called every pass of the main loop - leaf first, then the parents
+        Action onExit;
+        EventHandler onEvent;                           // Events not in the transition table - leaf first, then the parents
+    };
+
+    /**
+     * @brief Event driven transition - the first matching row wins
+     *
+     */
+    struct Transition {
+        uint8_t source;                                 // State (or parent state) we must be in, or ANY_STATE
+        uint8_t event;                                  // Event key
+        uint8_t target;                                 // Leaf state to go to
+    };
+
+    StateMachine(const StateDef (&states)[NUM_STATES], const Transition (&transitions)[NUM_TRANSITIONS], Context &context, EventKey eventKey) :
+        states(states), transitions(transitions), context(context), eventKey(eventKey) {
+    }
+
+    /**
+     * @brief Called with the leaf states at every transition - for logging and statistics
+     *
+     */
+    StateMachine &withTransitionHook(TransitionHook hook) {
+        transitionHook = hook;
+        return *this;
+    }
+
+    /**
+     * @brief Enters the initial state (and its parents, outermost first)
+     *
+     * @param initial Leaf state to start in
+     * @param from Reported to the transition hook as where we came from
+     */
+    void begin(uint8_t initial, uint8_t from) {
+        currentState = from;
+        pendingState = initial;
+        applyTransitions();
+    }
+
+    /**
+     * @brief Request a transition - taken when the current handler returns
+     *
+     */
+    void transition(uint8_t target) {
+        if (target < NUM_STATES) pendingState = target;
+    }
+
+    /**
+     * @brief Runs the tick handlers from the current state outwards, stopping once a transition is requested
+     *
+     */
+    void tick() {
+        for (uint8_t s = currentState; s < NUM_STATES && pendingState == NO_TRANSITION; s = states[s].parent) {
+            if (states[s].onTick) states[s].onTick(context);
+        }
+        applyTransitions();
+    }
+
+    /**
+     * @brief Queue an event - ISR safe, single producer
+     *
+     * @details The queue has one producer - ISRs that cannot preempt each other count as one, as the GPIO
+     * interrupts sharing an interrupt priority do.  The application thread uses dispatch() instead.
+     *
+     * @returns false if the queue was full
+     */
+    bool post(const Event &event) {
+        return queue.push(event);
+    }
+
+    /**
+     * @brief Handle an event right away - application thread only
+     *
+     */
+    void dispatch(const Event &event) {
+        uint8_t key = eventKey(event);
+
+        for (uint8_t i = 0; i < NUM_TRANSITIONS; i++) {
+            if (transitions[i].event == key && (transitions[i].source == ANY_STATE || isIn(transitions[i].source))) {
+                transition(transitions[i].target);
+                applyTransitions();
+                return;
+            }
+        }
+        for (uint8_t s = currentState; s < NUM_STATES; s = states[s].parent) {
+            if (states[s].onEvent && states[s].onEvent(context, event)) break;
+        }
+        applyTransitions();
+    }
+
+    /**
+     * @brief Dispatch everything the ISRs have queued
+     *
+     */
+    void dispatchEvents() {
+        Event event;
+        while (queue.pop(event)) dispatch(event);
+    }
+
+    /**
+     * @brief Are there events waiting to be dispatched
+     *
+     */
+    bool eventsPending() const {
+        return queue.available();
+    }
+
+    /**
+     * @brief Events lost because the queue was full - resets the count
+     *
+     */
+    uint16_t takeDroppedEvents() {
+        return queue.takeDropped();
+    }
+
+    uint8_t current() const { return currentState; }
+
+    uint8_t previous() const { return previousState; }
+
+    /**
+     * @brief Is state the current leaf state or one of its parents
+     *
+     */
+    bool isIn(uint8_t state) const {
+        for (uint8_t s = currentState; s < NUM_STATES; s = states[s].parent) {
+            if (s == state) return true;
+        }
+        return false;
+    }
+
+private:
+    /**
+     * @brief Is ancestor the state itself or one of its parents
+     *
+     */
+    bool contains(uint8_t ancestor, uint8_t state) const {
+        for (uint8_t s = state; s < NUM_STATES; s = states[s].parent) {
+            if (s == ancestor) return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Recursively enters from just below the common ancestor down to target
+     *
+     */
+    void enter(uint8_t target, uint8_t commonAncestor) {
+        if (target >= NUM_STATES || target == commonAncestor) return;
+        enter(states[target].parent, commonAncestor);
+        if (states[target].onEntry) states[target].onEntry(context);
+    }
+
+    void applyTransitions() {
+        // Entry handlers can request another transition - follow a few but never loop forever
+        for (uint8_t hops = 0; hops < 4 && pendingState != NO_TRANSITION; hops++) {
+            uint8_t target = pendingState;
+            pendingState = NO_TRANSITION;
+            if (target == currentState) continue;
+
+            // Exit up to the first state that also contains the target
+            uint8_t s = currentState;
+            while (s < NUM_STATES && !contains(s, target)) {
+                if (states[s].onExit) states[s].onExit(context);
+                s = states[s].parent;
+            }
+
+            previousState = currentState;
+            currentState = target;
+            if (transitionHook) transitionHook(context, previousState, target);
+            enter(target, s);
+        }
+    }
+
+    const StateDef (&states)[NUM_STATES];
+    const Transition (&transitions)[NUM_TRANSITIONS];
+    Context &context;
+    EventKey eventKey;
+    TransitionHook transitionHook = nullptr;
+    EventQueue<Event, QUEUE_SIZE> queue;
+    uint8_t currentState = NO_TRANSITION;
+    uint8_t previousState = NO_TRANSITION;
+    uint8_t pendingState = NO_TRANSITION;
+};
+
+#endif  /* __STATE_MACHINE_H */
@@ -0,0 +1,118 @@
+//Particle Functions
+#include "Particle.h"
+#include "MyPersistentData.h"
+#include "PublishQueuePosixRK.h"
+#include "Alert_Handling.h"
+#include "State_Stats.h"
+
+State_Stats *State_Stats::_instance;
+
+namespace {
+  static_assert(stateStatsData::NUM_STATES == LEAF_STATE_COUNT && LEAF_STATE_COUNT < STATE_COUNT, "State statistics must cover every leaf state");
+
+  const uint8_t webhookTimeoutAlert = 40;                         // Raised by Response Wait when the webhook does not answer
+
+  const unsigned long dwellBinLimits[stateStatsData::NUM_DWELL_BINS - 1] = {1000UL, 10000UL, 60000UL, 300000UL, 1800000UL};
+  const unsigned long errorReentryWindow = 600000UL;              // Back in Error within 10 minutes counts as a re-entry
+
+  // Daily thresholds for the anomaly flags
+  const uint16_t webhookTimeoutLimit = 3;
+  const uint16_t errorReentryLimit = 2;
+  const uint16_t slowConnectLimit = 3;
+}
+
+// [static]
+State_Stats &State_Stats::instance() {
+  if (!_instance) {
+      _instance = new State_Stats();
+  }
+  return *_instance;
+}
+
+State_Stats::State_Stats() {
+}
+
+State_Stats::~State_Stats() {
+}
+
+void State_Stats::setup() {
+  stateStats.setup();
+  stateEnteredMillis = millis();
+}
+
+void State_Stats::loop() {
+  stateStats.loop();
+}
+
+uint8_t State_Stats::dwellBin(unsigned long dwellMs) const {
+  uint8_t bin = 0;
+  while (bin < stateStatsData::NUM_DWELL_BINS - 1 && dwellMs >= dwellBinLimits[bin]) bin++;
+  return bin;
+}
+
+void State_Stats::recordTransition(uint8_t from, uint8_t to) {
+  unsigned long dwellMs = millis() - stateEnteredMillis;
+  uint8_t bin = dwellBin(dwellMs);
+  uint8_t flags = stateStats.get_anomalyFlags();
+
+  stateEnteredMillis = millis();
+  if (stateStats.get_transitions(from, to) < 0xFFFF) stateStats.set_transitions(from, to, stateStats.get_transitions(from, to) + 1);
+  if (stateStats.get_dwell(from, bin) < 0xFFFF) stateStats.set_dwell(from, bin, stateStats.get_dwell(from, bin) + 1);
+
+  if (to == ERROR_STATE && Alert_Handling::instance().isPending(webhookTimeoutAlert)) {   // Still pending - errorEntry resolves it after this
+    stateStats.set_webhookTimeouts(stateStats.get_webhookTimeouts() + 1);
+    if (stateStats.get_webhookTimeouts() > webhookTimeoutLimit) flags |= ANOMALY_WEBHOOK_TIMEOUTS;
+  }
+
+  if (from == ERROR_STATE) errorExitMillis = millis();
+  else if (to == ERROR_STATE && errorExitMillis != 0 && millis() - errorExitMillis < errorReentryWindow) {
+    stateStats.set_errorReentries(stateStats.get_errorReentries() + 1);
+    if (stateStats.get_errorReentries() > errorReentryLimit) flags |= ANOMALY_ERROR_REENTRY;
+  }
+
+  // The two longest bins are more than 5 minutes
+  if (from == CONNECTING_STATE && stateStats.get_dwell(from, stateStatsData::NUM_DWELL_BINS - 1) + stateStats.get_dwell(from, stateStatsData::NUM_DWELL_BINS - 2) > slowConnectLimit) {
+    flags |= ANOMALY_SLOW_CONNECT;
+  }
+
+  if (flags != stateStats.get_anomalyFlags()) {
+    Log.info("State machine anomaly flags now 0x%02x", flags);
+    stateStats.set_anomalyFlags(flags);
+  }
+}
+
+void State_Stats::dailyReport() {
+  char data[768];
+  size_t len;
+
+  // Transitions are sent as "from>to":count for the non-zero cells only
+  len = snprintf(data, sizeof(data), "{\"tr\":{");
+  bool first = true;
+  for (uint8_t from = 0; from < stateStatsData::NUM_STATES; from++) {
+    for (uint8_t to = 0; to < stateStatsData::NUM_STATES; to++) {
+      uint16_t count = stateStats.get_transitions(from, to);
+      if (count == 0 || len >= sizeof(data)) continue;
+      len += snprintf(&data[len], sizeof(data) - len, "%s\"%d>%d\":%u", (first) ? "" : ",", from, to, count);
+      first = false;
+    }
+  }
+
+  // Dwell histograms are one array of bins per state
+  if (len < sizeof(data)) len += snprintf(&data[len], sizeof(data) - len, "},\"dw\":[");
+  for (uint8_t state = 0; state < stateStatsData::NUM_STATES && len < sizeof(data); state++) {
+    len += snprintf(&data[len], sizeof(data) - len, "%s[", (state == 0) ? "" : ",");
+    for (uint8_t bin = 0; bin < stateStatsData::NUM_DWELL_BINS && len < sizeof(data); bin++) {
+      len += snprintf(&data[len], sizeof(data) - len, "%s%u", (bin == 0) ? "" : ",", stateStats.get_dwell(state, bin));
+    }
+    if (len < sizeof(data)) len += snprintf(&data[len], sizeof(data) - len, "]");
+  }
+
+  if (len < sizeof(data)) {
+    snprintf(&data[len], sizeof(data) - len, "],\"wt\":%u,\"er\":%u,\"flags\":%u,\"timestamp\":%lu000}", stateStats.get_webhookTimeouts(), stateStats.get_errorReentries(), stateStats.get_anomalyFlags(), Time.now());
+    PublishQueuePosix::instance().publish("stateStats", data, PRIVATE | WITH_ACK);
+  }
+  else Log.info("State statistics too large to publish");
+
+  stateStats.initialize();                                        // Start a new day
+  stateStats.flush(true);
+}
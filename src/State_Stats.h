@@ -0,0 +1,114 @@
+/*
+ * @file State_Stats.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief Keeps a transition matrix, per-state dwell time histograms and anomaly flags for the state machine
+ * in FRAM and reports them once a day
+ * 
+ * @version 0.1
+ * @date 2023-03-11
+ * 
+ */
+
+#ifndef __STATE_STATS_H
+#define __STATE_STATS_H
+
+#include "Particle.h"
+
+/**
+ * This class is a singleton; you do not create one as a global, on the stack, or with new.
+ * 
+ * From global application setup you must call:
+ * State_Stats::instance().setup();
+ * 
+ * From global application loop you must call:
+ * State_Stats::instance().loop();
+ */
+class State_Stats {
+public:
+    /**
+     * @brief Anomaly flags - set when a counter crosses its daily threshold, cleared by the daily report
+     * 
+     */
+    enum AnomalyFlag : uint8_t {
+        ANOMALY_WEBHOOK_TIMEOUTS = 0x01,                // Webhook timeouts (alert 40) are sending us to Error
+        ANOMALY_ERROR_REENTRY = 0x02,                   // Error state is being re-entered soon after leaving it
+        ANOMALY_SLOW_CONNECT = 0x04                     // Connecting is regularly taking more than 5 minutes
+    };
+
+    /**
+     * @brief Gets the singleton instance of this class, allocating it if necessary
+     * 
+     * Use State_Stats::instance() to instantiate the singleton.
+     */
+    static State_Stats &instance();
+
+    /**
+     * @brief Perform setup operations; call this from global application setup()
+     * 
+     * You typically use State_Stats::instance().setup();
+     */
+    void setup();
+
+    /**
+     * @brief Perform application loop operations; call this from global application loop()
+     * 
+     * You typically use State_Stats::instance().loop();
+     */
+    void loop();
+
+    /**
+     * @brief Records a state transition - counts it and bins the time spent in the state we are leaving
+     * 
+     * @param from The state we are leaving
+     * @param to The state we are entering
+     */
+    void recordTransition(uint8_t from, uint8_t to);
+
+    /**
+     * @brief Queues the day's statistics as a "stateStats" event and starts a new day
+     * 
+     * @details Called from dailyCleanup() - the event goes out with the first connection
+     * 
+     */
+    void dailyReport();
+
+protected:
+    /**
+     * @brief The constructor is protected because the class is a singleton
+     * 
+     * Use State_Stats::instance() to instantiate the singleton.
+     */
+    State_Stats();
+
+    /**
+     * @brief The destructor is protected because the class is a singleton and cannot be deleted
+     */
+    virtual ~State_Stats();
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    State_Stats(const State_Stats&) = delete;
+
+    /**
+     * This class is a singleton and cannot be copied
+     */
+    State_Stats& operator=(const State_Stats&) = delete;
+
+    /**
+     * @brief Singleton instance of this class
+     * 
+     * The object pointer to this class is stored here. It's NULL at system boot.
+     */
+    static State_Stats *_instance;
+
+    /**
+     * @brief Histogram bin for a dwell time
+     * 
+     */
+    uint8_t dwellBin(unsigned long dwellMs) const;
+
+    unsigned long stateEnteredMillis = 0;               // When we entered the current state
+    unsigned long errorExitMillis = 0;                  // When we last left the Error state - 0 if we have not
+};
+#endif  /* __STATE_STATS_H */
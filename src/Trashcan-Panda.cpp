@@ -15,7 +15,6 @@
 *   Three times a day (need to validate) at 6am, noon and 6pm - it will send the collected data to Particle via webhook and on to Ubidots
 *   Items yet to be worked on:
 *     - Using the TOF sensors' ability to "point" and "focus" to get a more accurate reading
-*     - Taking adiditional steps to ensure the device does not waste time connecting if there is an outage
 *     - Working out how to manage power on the sensor board (shutdown via i2c commands and the power line) - currently power on resets device
 */
 
@@ -59,6 +58,7 @@
 #include "BackgroundPublishRK.h"
 #include "PublishQueuePosixRK.h"
 #include "LocalTimeRK.h"
+#include "deviceid_hal.h"
 
 // Libraries to move out common functions (lower case = not Singleton)
 #include "device_pinout.h"
@@ -66,65 +66,89 @@
 #include "MyPersistentData.h"
 #include "Particle_Functions.h"
 #include "take_measurements.h"
+#include "Measure_Trash.h"
+#include "Binary_Log.h"
+#include "App_States.h"
+#include "App_Machine.h"
+#include "State_Stats.h"
+#include "Memory_Stats.h"
+#include "Daily_Stats.h"
+#include "Wake_Schedule.h"
+#include "Benchmark.h"
+#include "Rtc_Time.h"
 
 #define FIRMWARE_RELEASE 4.01						            // Will update this and report with stats
 PRODUCT_VERSION(4);									                // For now, we are putting nodes and gateways in the same product group - need to deconflict #
 
 // Prototype Functions
-void publishStateTransition(void);                  // Keeps track of state machine changes - for debugging
+void publishStateTransition(AppContext &ctx, uint8_t from, uint8_t to);  // Keeps track of state machine changes - for debugging
 void userSwitchISR();                               // interrupt service routime for the user switch
 void sensorISR(); 
 void countSignalTimerISR();							            // Keeps the Blue LED on
 void UbidotsHandler(const char *event, const char *data);
 bool isParkOpen(bool verbose);						          // Simple function returns whether park is open or not
 void dailyCleanup();								                // Reset each morning
+void connectionFailed();							                // Backs off hourly connection attempts
 void softDelay(uint32_t t);			                    // Extern function for safe delay()
 
 // System Health Variables
 int outOfMemory = -1;                               // From reference code provided in AN0023 (see above)
 
-// State Machine Variables
-enum State { INITIALIZATION_STATE, ERROR_STATE, IDLE_STATE, SLEEPING_STATE, NAPPING_STATE, CONNECTING_STATE, REPORTING_STATE, RESP_WAIT_STATE};
-char stateNames[9][16] = {"Initialize", "Error", "Idle", "Sleeping", "Napping", "Connecting", "Reporting", "Response Wait"};
-State state = INITIALIZATION_STATE;
-State oldState = INITIALIZATION_STATE;
+// State Machine Variables - the State enum is in App_States.h, the tables in App_Machine.h
+const char * const stateNames[] = {"Initialize", "Error", "Idle", "Sleeping", "Napping", "Connecting", "Reporting", "Response Wait", "Awake"};
 
 // Prototypes and System Mode calls
-SystemSleepConfiguration config;                    // Initialize new Sleep 2.0 Api
 void outOfMemoryHandler(system_event_t event, int param);
 extern LocalTimeConvert conv;								        // For determining if the park should be opened or closed - need local time
 AB1805 ab1805(Wire);                                // Rickkas' RTC / Watchdog library
 
 // Program Variables
-volatile bool userSwitchDectected = false;		
-volatile bool sensorDetect = false;					        // Flag for sensor interrupt
 bool dataInFlight = false;                          // Flag for whether we are waiting for a response from the webhook
+bool sensorsReady = false;                          // Sensors came up in setup() - carried across planned resets
 
 Timer countSignalTimer(1000, countSignalTimerISR, true);      // This is how we will ensure the BlueLED stays on long enough for folks to see it.
 
 // Timing variables
 const int wakeBoundary = 1*3600 + 0*60 + 0;         // Sets a reporting frequency of 1 hour 0 minutes 0 seconds
-const unsigned long stayAwakeLong = 90000UL;        // In lowPowerMode, how long to stay awake every hour
+const int reportWindow = 10*60;                     // Devices spread their reports over the first 10 minutes of each period
+const int autonomousBoundary = 4*3600;              // With autonomous TOF ranging the sensor wakes us - only a heartbeat every 4 hours
+int wakeOffset = 0;                                 // This device's place in the report window - set in setup()
 const unsigned long stayAwakeShort = 1000UL;		  	// In lowPowerMode, how long to stay awake when not reporting
 const unsigned long webhookWait = 45000UL;          // How long will we wait for a WebHook response
 const unsigned long resetWait = 30000UL;            // How long will we wait in ERROR_STATE until reset
-unsigned long stayAwakeTimeStamp = 0UL;             // Timestamps for our timing variables..
-unsigned long stayAwake = stayAwakeLong;            // Stores the time we need to wait before napping
+const uint32_t switchDebounceMicros = 50000UL;      // Contact bounce on the user switch
+const uint32_t lidDebounceMicros = 2000000UL;       // One lid opening is a burst of accelerometer interrupts
+const time_t resumeMaxAge = 120;                    // A planned reset checkpoint older than this (seconds) is ignored
+const int cellularProbeWait = 180;                  // Seconds to register on the cellular network before we give up without trying the cloud
+const int connectWait = 600;                        // Seconds for the whole connection before we give up
+const time_t connectBackoffBase = 3600;             // After consecutive failures skip hourly connects for 1, 2, 4 ... hours
+const time_t connectBackoffMax = 8*3600;            // An outage costs at most three short attempts a day - alert 31's escalation window must outlast this
+
+AppContext appContext;
+AppStateMachine appMachine(appStates, appTransitions, appContext, appEventKey);
 
 
 void setup()                                        // Note: Disconnected Setup()
 {
+	State startState = INITIALIZATION_STATE;		// Where the state machine will start
   // Make sure you match the same Wire interface in the constructor to LIS3DHI2C to this!
 	Wire.setSpeed(CLOCK_SPEED_100KHZ);
 
- 	char responseTopic[125];
-	String deviceID = System.deviceID();              // Multiple devices share the same hook - keeps things straight
-	deviceID.toCharArray(responseTopic,125);          // Puts the deviceID into the response topic array
-	Particle.subscribe(responseTopic, UbidotsHandler, MY_DEVICES);      // Subscribe to the integration response event
+ 	char deviceID[25];								// Multiple devices share the same hook - keeps things straight
+	char timeStr[32];								// For the startup log lines - no String allocations
+	uint8_t deviceIdBytes[12];
+	hal_get_device_id(deviceIdBytes, sizeof(deviceIdBytes));	// What System.deviceID() formats into a String
+	for (size_t i = 0; i < sizeof(deviceIdBytes); i++) snprintf(deviceID + 2*i, 3, "%02x", deviceIdBytes[i]);
+	Particle.subscribe(deviceID, UbidotsHandler, MY_DEVICES);      // Subscribe to the integration response event
 	System.on(out_of_memory, outOfMemoryHandler);     // Enabling an out of memory handler is a good safety tip. If we run out of memory a System.reset() is done.
 
-	waitFor(Serial.isConnected, 10000);               // Wait for serial to connect - for debugging
-	softDelay(2000);								  // For serial monitoring - can delete
+	resumeCheckpoint.setup();						// Retained RAM checkpoint - only armed just before a planned reset
+	bool fastResume = resumeCheckpoint.takeResume(resumeMaxAge);
+
+	if (!fastResume) {
+		waitFor(Serial.isConnected, 10000);           // Wait for serial to connect - for debugging
+		softDelay(2000);							  // For serial monitoring - can delete
+	}
 
 	Particle_Functions::instance().setup();			// Initialize Particle Functions and Variables
 
@@ -138,6 +162,13 @@ void setup()                                        // Note: Disconnected Setup(
 	sysStatus.set_firmwareRelease(FIRMWARE_RELEASE);
 	current.setup();
 	current.set_alertCode(0);						// Clear any alert codes
+	alertStatus.setup();							// Alert history - drives the escalation ladders
+	Binary_Log::instance().setup();					// Persistent log ring for remote log pulls
+	State_Stats::instance().setup();				// Transition counts and dwell times for the state machine
+	Memory_Stats::instance().setup();				// Heap and stack low water marks for each state
+	Daily_Stats::instance().setup();				// Fill, lid, battery and connection aggregates for the day
+	tofCal.setup();									// Learned TOF error vs temperature
+	tzConfig.setup();								// Timezone rule set with the "tz" command
 
   	PublishQueuePosix::instance().setup();          // Start the Publish Queue
 	PublishQueuePosix::instance().withFileQueueSize(200);
@@ -145,35 +176,47 @@ void setup()                                        // Note: Disconnected Setup(
 	// Take note if we are restarting due to a pin reset - either by the user or the watchdog - could be sign of trouble
   	if (System.resetReason() == RESET_REASON_PIN_RESET || System.resetReason() == RESET_REASON_USER) { // Check to see if we are starting from a pin reset or a reset in the sketch
     	sysStatus.set_resetCount(sysStatus.get_resetCount() + 1);
-    	if (sysStatus.get_resetCount() > 3) current.set_alertCode(13);                 // Excessive resets 
+    	if (sysStatus.get_resetCount() > 3) Alert_Handling::instance().raiseAlert(13);                 // Excessive resets 
   	}
 
+	Rtc_Time::instance().setup();					// System clock from the RTC, corrected for drift - saves a connection after a power down
     ab1805.withFOUT(D8).setup();                	// Initialize AB1805 RTC   
-	if (!ab1805.detectChip()) current.set_alertCode(12);
+	if (!ab1805.detectChip()) Alert_Handling::instance().raiseAlert(12);
     ab1805.setWDT(AB1805::WATCHDOG_MAX_SECONDS);	// Enable watchdog
 
 	// Setup local time and set the publishing schedule
-	LocalTime::instance().withConfig(LocalTimePosixTimezone("EST5EDT,M3.2.0/2:00:00,M11.1.0/2:00:00"));			// East coast of the US
-	conv.withCurrentTime().convert();  	
+	Particle_Functions::instance().applyTimezone();	// Rule stored in tzConfig or the compiled in East coast rule
+	wakeOffset = Wake_Schedule::phaseOffset(deviceID, reportWindow);	// Same slot every hour for this device
+	Log.info("Reporting %i seconds after each hour", wakeOffset);
 
 	System.on(out_of_memory, outOfMemoryHandler);   // Enabling an out of memory handler is a good safety tip. If we run out of memory a System.reset() is done.
 
-	if (!Take_Measurements::instance().setup()) current.set_alertCode(12);			// Initialize the sensor and take measurements
+	if (fastResume && resumeCheckpoint.get_sensorsReady()) {	// Planned reset - sensors are still configured and the last readings are in current
+		Log.info("Planned reset - resuming in %s", stateNames[resumeCheckpoint.get_resumeState()]);
+		sensorsReady = true;
+		startState = (State)resumeCheckpoint.get_resumeState();
+	}
+	else {
+		sensorsReady = Take_Measurements::instance().setup();
+		if (!sensorsReady) Alert_Handling::instance().raiseAlert(12);			// Initialize the sensor and take measurements
 
-  	Take_Measurements::instance().takeMeasurements();   // Populates values so you can read them before the hour
+  		Take_Measurements::instance().takeMeasurements();   // Populates values so you can read them before the hour
+	}
 
 	if (!digitalRead(BUTTON_PIN)) {						// The user will press this button at startup to reset settings
 		Log.info("User button at startup - setting defaults");
-		state = CONNECTING_STATE;
+		startState = CONNECTING_STATE;
 		sysStatus.initialize();                  	// Make sure the device wakes up and connects - reset to defaults and exit low power mode
 	}
 
 	if (!Time.isValid()) {
-		Log.info("Time is invalid -  %s so connecting", Time.timeStr().c_str());
-		state = CONNECTING_STATE;
+		LocalTime::timeToString(Time.now(), timeStr, sizeof(timeStr));
+		Log.info("Time is invalid -  %s so connecting", timeStr);
+		startState = CONNECTING_STATE;
 	}
 	else {
-		Log.info("LocalTime initialized, time is %s and RTC %s set", conv.format("%I:%M:%S%p").c_str(), (ab1805.isRTCSet()) ? "is" : "is not");
+		conv.format("%I:%M:%S%p", timeStr, sizeof(timeStr));
+		Log.info("LocalTime initialized, time is %s and RTC %s set", timeStr, (ab1805.isRTCSet()) ? "is" : "is not");
 		if (Time.day(sysStatus.get_lastConnection()) != Time.day()) {
 			Log.info("New day, resetting counts");
 			dailyCleanup();
@@ -184,236 +227,298 @@ void setup()                                        // Note: Disconnected Setup(
 	attachInterrupt(INT_PIN,sensorISR,RISING);      // We need to monitor the sensor for activity
 
 
-	if (state == INITIALIZATION_STATE) {
+	if (startState == INITIALIZATION_STATE) {
 		if(sysStatus.get_lowPowerMode()) {
-			state = IDLE_STATE;               	// Go to the IDLE state unless changed above
+			startState = IDLE_STATE;            // Go to the IDLE state unless changed above
 		}
 		else {
-			state = CONNECTING_STATE;          	// Go to the CONNECTING state unless changed above
+			startState = CONNECTING_STATE;      // Go to the CONNECTING state unless changed above
 		}
 	}
 
 	conv.withTime(sysStatus.get_lastConnection()).convert();	// Want to know the last time we connected in local time
-  	Log.info("Startup complete with last connect %s in %s", conv.format("%I:%M:%S%p").c_str(), (sysStatus.get_lowPowerMode()) ? "low power mode" : "normal mode");
+	conv.format("%I:%M:%S%p", timeStr, sizeof(timeStr));
+  	Log.info("Startup complete with last connect %s in %s", timeStr, (sysStatus.get_lowPowerMode()) ? "low power mode" : "normal mode");
 	conv.withCurrentTime().convert();
   	digitalWrite(BLUE_LED,LOW);                                          	// Signal the end of startup
 
 	isParkOpen(true);
 
 	Alert_Handling::instance().setup();
+
+	appMachine.withTransitionHook(publishStateTransition).begin(startState, INITIALIZATION_STATE);
 }
 
 
 void loop()
 {
-  switch(state) {
-		case IDLE_STATE: {													// Unlike most sketches - nodes spend most time in sleep and only transit IDLE once or twice each period
-			if (state != oldState) publishStateTransition();
-			if (sysStatus.get_lowPowerMode() && (millis() - stayAwakeTimeStamp) > stayAwake) state = SLEEPING_STATE;         // When in low power mode, we can nap between taps
-			if (isParkOpen(false) && Time.hour() != Time.hour(sysStatus.get_lastReport())) state = REPORTING_STATE;                                  // We want to report on the hour but not after bedtime
-		} break;
-
-		case SLEEPING_STATE: {
-			if (state != oldState) publishStateTransition();              	// We will apply the back-offs before sending to ERROR state - so if we are here we will take action
-	    	if (sensorDetect || countSignalTimer.isActive())  break;           // Don't nap until we are done with event - exits back to main loop but stays in napping state
-			if (Particle.connected() || !Cellular.isOff()) {
-				if (!Particle_Functions::instance().disconnectFromParticle()) {                                 // Disconnect cleanly from Particle and power down the modem
-					current.set_alertCode(15);
-					break;
-				}
-			}
-			if (!isParkOpen(true)) digitalWrite(ENABLE_PIN,HIGH);
-			else digitalWrite(ENABLE_PIN,LOW);
-			stayAwake = stayAwakeShort;                                       // Keeps device awake for just a second - when we are not reporting
-			int wakeInSeconds = constrain(wakeBoundary - Time.now() % wakeBoundary, 1, wakeBoundary) + 1;;	// Figure out how long to sleep 		
-			config.mode(SystemSleepMode::ULTRA_LOW_POWER)
-				.gpio(BUTTON_PIN,CHANGE)
-				.gpio(INT_PIN,RISING)
-				.duration(wakeInSeconds * 1000L);
-			ab1805.stopWDT();  												   // No watchdogs interrupting our slumber
-			SystemSleepResult result = System.sleep(config);              	// Put the device to sleep device continues operations from here
-			ab1805.resumeWDT();                                                // Wakey Wakey - WDT can resume
-			if (result.wakeupPin() == BUTTON_PIN) {                         // If the user woke the device we need to get up - device was sleeping so we need to reset opening hours
-				Log.info("Woke with user button - Resetting hours and going to connect");
-				sysStatus.set_lowPowerMode(false);
-				sysStatus.set_closeTime(24);
-				sysStatus.set_openTime(0);
-				stayAwake = stayAwakeLong;
-				stayAwakeTimeStamp = millis();
-				state = CONNECTING_STATE;
-			}
-			else if (result.wakeupPin() == INT_PIN) {
-				Log.info("Woke with sensor - counting");
-				state = IDLE_STATE;
-			}
-			else {															// In this state the device was awoken for hourly reporting
-				softDelay(2000);											// Gives the device a couple seconds to get the battery reading
-				Log.info("Time to wake up at %s with %li free memory", Time.format((Time.now()+wakeInSeconds), "%T").c_str(), System.freeMemory());
-				if (isParkOpen(true)) stayAwake = stayAwakeLong;                 // Keeps device awake after reboot - helps with recovery
-				state = IDLE_STATE;
-			}
-		} break;
-
-		case REPORTING_STATE: {
-			if (state != oldState) publishStateTransition();
-			sysStatus.set_lastReport(Time.now());                              // We are only going to report once each hour from the IDLE state.  We may or may not connect to Particle
-			Take_Measurements::instance().takeMeasurements();                  // Take Measurements here for reporting
-			if (Time.day(sysStatus.get_lastConnection()) != conv.getLocalTimeYMD().getDay()) {
-				dailyCleanup();
-				Log.info("New Day - Resetting everything");
-			}
-			Particle_Functions::instance().sendEvent();                        // Publish hourly but not at opening time as there is nothing to publish
-			state = CONNECTING_STATE;                                          // Default behaviour would be to connect and send report to Ubidots
-
-			// Let's see if we need to connect 
-			if (Particle.connected()) {                                        // We are already connected go to response wait
-				stayAwakeTimeStamp = millis();
-				state = RESP_WAIT_STATE;
-			}
-			// If we are in a low battery state - we are not going to connect unless we are over-riding with user switch (active low)
-			else if (sysStatus.get_lowBatteryMode() && digitalRead(BUTTON_PIN)) {
-				Log.info("Not connecting - low battery mode");
-				state = IDLE_STATE;
-			}
-			// If we are in low power mode, we may bail if battery is too low and we need to reduce reporting frequency
-			else if (sysStatus.get_lowPowerMode() && digitalRead(BUTTON_PIN)) {      // Low power mode and user switch not pressed
-				// Code ususally goes here around state of charge - but Pandas don'y use LiPO
-				Log.info("Connecting");
-			}
-		} break;
-
-  		case RESP_WAIT_STATE: {
-    		static unsigned long webhookTimeStamp = 0;                         // Webhook time stamp
-    		if (state != oldState) {
-      			webhookTimeStamp = millis();                                     // We are connected and we have published, head to the response wait state
-      			dataInFlight = true;                                             // set the data inflight flag
-      			publishStateTransition();
-    		}
-
-    		if (!dataInFlight)  {                                              // Response received --> back to IDLE state
-				stayAwakeTimeStamp = millis();
-      			state = IDLE_STATE;
-    		}
-    		else if (millis() - webhookTimeStamp > webhookWait) {              // If it takes too long - will need to reset
-				current.set_alertCode(40);
-			}
-  		} break;
-
-  		case CONNECTING_STATE:{                                              // Will connect - or not and head back to the Idle state - We are using a 3,5, 7 minute back-off approach as recommended by Particle
-			static State retainedOldState;                                   // Keep track for where to go next (depends on whether we were called from Reporting)
-			static unsigned long connectionStartTimeStamp;                   // Time in Millis that helps us know how long it took to connect
-			char data[64];                                                   // Holder for message strings
-
-			if (state != oldState) {                                         // Non-blocking function - these are first time items
-				retainedOldState = oldState;                                     // Keep track for where to go next
-				sysStatus.set_lastConnectionDuration(0);                         // Will exit with 0 if we do not connect or are already connected.  If we need to connect, this will record connection time.
-				publishStateTransition();
-				connectionStartTimeStamp = millis();                             // Have to use millis as the clock may get reset on connect
-				Particle.connect();                                              // Tells Particle to connect, now we need to wait
-			}
-
-			sysStatus.set_lastConnectionDuration(int((millis() - connectionStartTimeStamp)/1000));
-
-			if (Particle.connected()) {
-				sysStatus.set_lastConnection(Time.now());                    // This is the last time we last connected
-				stayAwakeTimeStamp = millis();                               // Start the stay awake timer now
-				Take_Measurements::instance().getSignalStrength();           // Test signal strength since the cellular modem is on and ready
-				snprintf(data, sizeof(data),"Connected in %i secs",sysStatus.get_lastConnectionDuration());  // Make up connection string and publish
-				Log.info(data);
-				if (sysStatus.get_verboseMode()) Particle.publish("Cellular",data,PRIVATE);
-				(retainedOldState == REPORTING_STATE) ? state = RESP_WAIT_STATE : state = IDLE_STATE; // so, if we are connecting to report - next step is response wait - otherwise IDLE
-			}
-			else if (sysStatus.get_lastConnectionDuration() > 600) { 		// What happens if we do not connect - non-zero alert code will send us to the Error state
-				Log.info("Failed to connect in 10 minutes");
-				if (Cellular.ready()) current.set_alertCode(30);
-				else current.set_alertCode(31);
-				sysStatus.set_lowPowerMode(true);						    // If we are not connected after 10 minutes, we are going to go to low power mode
-			}
-		} break;
-
-		case ERROR_STATE: {													// Where we go if things are not quite right
-			static int alertResponse = 0;
-			static unsigned long resetTimer = millis();
-
-			if (state != oldState) {
-				publishStateTransition();                					// We will apply the back-offs before sending to ERROR state - so if we are here we will take action
-				alertResponse = Alert_Handling::instance().alertResolution();
-				Log.info("Alert Response: %i so %s",alertResponse, (alertResponse == 0) ? "No action" : (alertResponse == 1) ? "Connecting" : (alertResponse == 2) ? "Reset" : (alertResponse == 3) ? "Power Down" : "Unknown");
-				resetTimer = millis();
-			}
-
-			if (alertResponse >= 2 && millis()-resetTimer < 30000L) break;
-			else Log.info("Delay is up - executing");
-
-			switch (alertResponse) {
-				case 0:
-					Log.info("No Action - Going to Idle");
-					state = IDLE_STATE;					// Least severity - no additional action required
-					break;
-				case 1:
-					Log.info("Need to report - connecting");
-					state = CONNECTING_STATE;			// Issue that needs to be reported - could be in a reset loop
-					break;
-				case 2:
-					Log.info("Resetting");
-					delay(1000);						// Give the system a second to get the message out
-					System.reset();						// device needs to be reset
-					break;
-				case 3: 
-					Log.info("Powering down");
-					delay(1000);						// Give the system a second to get the message out
-					ab1805.deepPowerDown();				// Power off the device for 30 seconds
-					break;
-				default:								// Ensure we do not get trapped in the ERROR State
-					System.reset();
-					break;
-			}
-		} break;
-  }
+	appMachine.tick();									// Runs the current state's handlers (see the state handlers below)
+
   // Take care of housekeeping items here
+	Rtc_Time::instance().loop();						// Learns the RTC drift at each time sync - ahead of the library setting the RTC
 	ab1805.loop();                                  	// Keeps the RTC synchronized with the Boron's clock
 
 	// Housekeeping for each transit of the main loop
 	current.loop();
 	sysStatus.loop();
+	alertStatus.loop();
+	State_Stats::instance().loop();
+	Memory_Stats::instance().loop();
+	Daily_Stats::instance().loop();
+	tofCal.loop();
+	tzConfig.loop();
 
 	PublishQueuePosix::instance().loop();               // Check to see if we need to tend to the message queue
+	Binary_Log::instance().loop();						// Formats deferred log records - only if Serial is connected
 	Alert_Handling::instance().loop();	
+	Benchmark::instance().loop();						// Only does anything after a "bench" command
+	Particle_Functions::instance().loop();				// Measurements and webhooks asked for by the status and send commands
 
 	if (outOfMemory >= 0) {                         	// In this function we are going to reset the system if there is an out of memory error
-	  current.set_alertCode(14);
+	  Alert_Handling::instance().raiseAlert(14);
   	}
 
-	if (current.get_alertCode() > 0) state = ERROR_STATE;
+	if (Alert_Handling::instance().alertsPending()) appMachine.dispatch({ALERT_EVENT, (uint32_t)micros(), 0});
+
+	appMachine.dispatchEvents();						// User switch and sensor interrupts queued by the ISRs
+	uint16_t droppedEvents = appMachine.takeDroppedEvents();
+	if (droppedEvents > 0) Binary_Log::instance().record(Binary_Log::MSG_EVENTS_DROPPED, droppedEvents);
+  // End of housekeeping - end of main loop
+}
+
+// ******************************  State Handlers  ******************************
+
+void idleTick(AppContext &ctx) {						// Unlike most sketches - nodes spend most time in sleep and only transit IDLE once or twice each period
+	if (sysStatus.get_lowPowerMode() && (millis() - ctx.stayAwakeTimeStamp) > ctx.stayAwake) appMachine.transition(SLEEPING_STATE);         // When in low power mode, we can nap between taps
+	if (isParkOpen(false) && Time.hour() != Time.hour(sysStatus.get_lastReport()) && Wake_Schedule::inReportSlot(Time.now(), wakeBoundary, wakeOffset)) appMachine.transition(REPORTING_STATE);   // We want to report each hour (in our slot) but not after bedtime
+}
+
+void sleepingTick(AppContext &ctx) {
+	if (appMachine.eventsPending() || countSignalTimer.isActive()) return;           // Don't nap until we are done with event - exits back to main loop but stays in napping state
+	if (Particle.connected() || !Cellular.isOff()) {
+		if (!Particle_Functions::instance().disconnectFromParticle()) {                                 // Disconnect cleanly from Particle and power down the modem
+			Alert_Handling::instance().raiseAlert(15);
+			return;
+		}
+	}
+	if (!isParkOpen(true)) digitalWrite(ENABLE_PIN,HIGH);
+	else digitalWrite(ENABLE_PIN,LOW);
+	ctx.stayAwake = stayAwakeShort;                                       // Keeps device awake for just a second - when we are not reporting
+	Measure_Trash::instance().clearAccelInterrupt();					// A latched INT1 holds INT_PIN high and no movement could wake us
+	int sleepBoundary = (sysStatus.get_tofAutonomous() && isParkOpen(false)) ? autonomousBoundary : wakeBoundary;
+	int wakeInSeconds = Wake_Schedule::secondsToNextWake(Time.now(), sleepBoundary, wakeOffset);	// Figure out how long to sleep 		
+	SystemSleepConfiguration config;					// Sleep 2.0 Api - built fresh each time as wake pins cannot be removed
+	config.mode(SystemSleepMode::ULTRA_LOW_POWER)
+		.gpio(BUTTON_PIN,CHANGE)
+		.gpio(INT_PIN,RISING)
+		.duration(wakeInSeconds * 1000L);
+	if (sysStatus.get_tofAutonomous()) config.gpio(TOF_INT_PIN,RISING);	// Fill band crossings - lid movement still wakes us on INT_PIN
+	ab1805.stopWDT();  												   // No watchdogs interrupting our slumber
+	SystemSleepResult result = System.sleep(config);              	// Put the device to sleep device continues operations from here
+	ab1805.resumeWDT();                                                // Wakey Wakey - WDT can resume
+	if (result.wakeupPin() == BUTTON_PIN) {                         // If the user woke the device we need to get up - device was sleeping so we need to reset opening hours
+		Log.info("Woke with user button - Resetting hours and going to connect");
+		sysStatus.set_lowPowerMode(false);
+		sysStatus.set_closeTime(24);
+		sysStatus.set_openTime(0);
+		ctx.stayAwake = stayAwakeLong;
+		ctx.stayAwakeTimeStamp = millis();
+		appMachine.transition(CONNECTING_STATE);
+	}
+	else if (result.wakeupPin() == TOF_INT_PIN) {
+		Log.info("Woke with TOF fill band crossing - reporting");
+		ctx.stayAwake = stayAwakeLong;
+		appMachine.transition(REPORTING_STATE);			// Measures, re-arms the thresholds and reports
+	}
+	else if (result.wakeupPin() == INT_PIN) {
+		Log.info("Woke with sensor - counting");
+		appMachine.dispatch({SENSOR_EVENT, (uint32_t)micros(), HIGH});	// Counted here - only the ISRs post to the queue.  A duplicate from the ISR falls inside the debounce
+		appMachine.transition(IDLE_STATE);
+	}
+	else {															// In this state the device was awoken for hourly reporting
+		softDelay(2000);											// Gives the device a couple seconds to get the battery reading
+		Binary_Log::instance().record(Binary_Log::MSG_WAKE, (long)System.freeMemory());
+		if (isParkOpen(true)) ctx.stayAwake = stayAwakeLong;                 // Keeps device awake after reboot - helps with recovery
+		appMachine.transition(IDLE_STATE);
+	}
+}
 
-	if (sensorDetect) {									// If the sensor has been triggered, we need to record the count
-		sensorDetect = false;
+void reportingTick(AppContext &ctx) {
+	sysStatus.set_lastReport(Time.now());                              // We are only going to report once each hour from the IDLE state.  We may or may not connect to Particle
+	Take_Measurements::instance().takeMeasurements();                  // Take Measurements here for reporting
+	if (Time.day(sysStatus.get_lastConnection()) != conv.getLocalTimeYMD().getDay()) {
+		dailyCleanup();
+		Log.info("New Day - Resetting everything");
+	}
+	Particle_Functions::instance().sendEvent();                        // Publish hourly but not at opening time as there is nothing to publish
+	appMachine.transition(CONNECTING_STATE);                           // Default behaviour would be to connect and send report to Ubidots
 
-	}		
+	// Let's see if we need to connect 
+	if (Particle.connected()) {                                        // We are already connected go to response wait
+		ctx.stayAwakeTimeStamp = millis();
+		appMachine.transition(RESP_WAIT_STATE);
+	}
+	// After failed connections we back off - the report waits in the publish queue unless the user switch is pressed
+	else if (Time.now() < sysStatus.get_nextConnectTime() && sysStatus.get_nextConnectTime() - Time.now() <= connectBackoffMax && digitalRead(BUTTON_PIN)) {
+		int minutesLeft = (int)((sysStatus.get_nextConnectTime() - Time.now()) / 60);
+		Log.info("Not connecting - %i failures so backing off for %i more minutes", sysStatus.get_connectFailures(), minutesLeft);
+		Binary_Log::instance().record(Binary_Log::MSG_CONNECT_SKIPPED, minutesLeft);
+		appMachine.transition(IDLE_STATE);
+	}
+	// If we are in a low battery state - we are not going to connect unless we are over-riding with user switch (active low)
+	else if (sysStatus.get_lowBatteryMode() && digitalRead(BUTTON_PIN)) {
+		Log.info("Not connecting - low battery mode");
+		appMachine.transition(IDLE_STATE);
+	}
+	// If we are in low power mode, we may bail if battery is too low and we need to reduce reporting frequency
+	else if (sysStatus.get_lowPowerMode() && digitalRead(BUTTON_PIN)) {      // Low power mode and user switch not pressed
+		// Code ususally goes here around state of charge - but Pandas don'y use LiPO
+		Log.info("Connecting");
+	}
+}
 
-	if (userSwitchDectected) {							// If the user switch has been pressed, we need to reset the device
-		userSwitchDectected = false;
-		digitalWrite(ENABLE_PIN, !digitalRead(ENABLE_PIN));						// Toggle the enable pin
+void respWaitEntry(AppContext &ctx) {
+	ctx.webhookTimeStamp = millis();                                     // We are connected and we have published, head to the response wait state
+	dataInFlight = true;                                                 // set the data inflight flag
+}
+
+void respWaitTick(AppContext &ctx) {
+	if (!dataInFlight)  {                                              // Response received --> back to IDLE state
+		ctx.stayAwakeTimeStamp = millis();
+		appMachine.transition(IDLE_STATE);
+	}
+	else if (millis() - ctx.webhookTimeStamp > webhookWait) {          // If it takes too long - will need to reset
+		Binary_Log::instance().trace(Binary_Log::MSG_TRACE_WEBHOOK, 0, (unsigned long)(millis() - ctx.webhookTimeStamp));
+		Alert_Handling::instance().raiseAlert(40);
+	}
+}
+
+void connectingEntry(AppContext &ctx) {                                // Will connect - or not and head back to the Idle state
+	ctx.connectingFrom = appMachine.previous();                          // Keep track for where to go next
+	sysStatus.set_lastConnectionDuration(0);                             // Will exit with 0 if we do not connect or are already connected.  If we need to connect, this will record connection time.
+	ctx.connectionStartTimeStamp = millis();                             // Have to use millis as the clock may get reset on connect
+	ctx.cloudConnecting = false;
+	Cellular.on();                                                       // Registration first - the cloud handshake only once we are on the network
+	Cellular.connect();
+}
+
+void connectingTick(AppContext &ctx) {
+	char data[64];                                                   // Holder for message strings
+
+	sysStatus.set_lastConnectionDuration(int((millis() - ctx.connectionStartTimeStamp)/1000));
+
+	if (Particle.connected()) {
+		sysStatus.set_lastConnection(Time.now());                    // This is the last time we last connected
+		sysStatus.set_connectFailures(0);                            // Outage over - back to connecting every hour
+		sysStatus.set_nextConnectTime(0);
+		Alert_Handling::instance().clearEscalation(30);              // Connected - any connection alert ladders start over
+		Alert_Handling::instance().clearEscalation(31);
+		ctx.stayAwakeTimeStamp = millis();                           // Start the stay awake timer now
+		Take_Measurements::instance().getSignalStrength();           // Test signal strength since the cellular modem is on and ready
+		Binary_Log::instance().trace(Binary_Log::MSG_TRACE_CONNECT, 0, sysStatus.get_lastConnectionDuration());
+		Binary_Log::instance().record(Binary_Log::MSG_CONNECTED, sysStatus.get_lastConnectionDuration());
+		Daily_Stats::instance().addConnection(sysStatus.get_lastConnectionDuration());
+		if (sysStatus.get_verboseMode()) {
+			snprintf(data, sizeof(data),"Connected in %i secs",sysStatus.get_lastConnectionDuration());  // Make up connection string and publish
+			Particle.publish("Cellular",data,PRIVATE);
+		}
+		appMachine.transition((ctx.connectingFrom == REPORTING_STATE) ? RESP_WAIT_STATE : IDLE_STATE); // so, if we are connecting to report - next step is response wait - otherwise IDLE
+	}
+	else if (!ctx.cloudConnecting && Cellular.ready()) {
+		ctx.cloudConnecting = true;
+		Particle.connect();                                              // On the network - tells Particle to connect, now we need to wait
+	}
+	else if (!Cellular.ready() && sysStatus.get_lastConnectionDuration() > cellularProbeWait) {	// No network - do not spend the full 10 minutes finding out
+		Log.info("No cellular registration in %i secs", cellularProbeWait);
+		Binary_Log::instance().trace(Binary_Log::MSG_TRACE_CONNECT, 2, sysStatus.get_lastConnectionDuration());
+		Alert_Handling::instance().raiseAlert(31);
+		sysStatus.set_lowPowerMode(true);
+		connectionFailed();
+	}
+	else if (sysStatus.get_lastConnectionDuration() > connectWait) { 	// What happens if we do not connect - a pending alert will send us to the Error state
+		Log.info("Failed to connect in 10 minutes");
+		Binary_Log::instance().trace(Binary_Log::MSG_TRACE_CONNECT, Cellular.ready() ? 1 : 2, sysStatus.get_lastConnectionDuration());
+		if (Cellular.ready()) Alert_Handling::instance().raiseAlert(30);
+		else Alert_Handling::instance().raiseAlert(31);
+		sysStatus.set_lowPowerMode(true);						    // If we are not connected after 10 minutes, we are going to go to low power mode
+		connectionFailed();
+	}
+}
+
+void errorEntry(AppContext &ctx) {									// Where we go if things are not quite right
+	ctx.alertResponse = Alert_Handling::instance().alertResolution();	// We will apply the back-offs before sending to ERROR state - so if we are here we will take action
+	Log.info("Alert Response: %i so %s",ctx.alertResponse, (ctx.alertResponse == 0) ? "No action" : (ctx.alertResponse == 1) ? "Connecting" : (ctx.alertResponse == 2) ? "Reset" : (ctx.alertResponse == 3) ? "Power Down" : "Unknown");
+	ctx.resetTimer = millis();
+}
+
+void errorTick(AppContext &ctx) {
+	if (ctx.alertResponse >= 2 && millis() - ctx.resetTimer < resetWait) return;
+	else Log.info("Delay is up - executing");
+
+	switch (ctx.alertResponse) {
+		case 0:
+			Log.info("No Action - Going to Idle");
+			appMachine.transition(IDLE_STATE);			// Least severity - no additional action required
+			break;
+		case 1:
+			Log.info("Need to report - connecting");
+			appMachine.transition(CONNECTING_STATE);	// Issue that needs to be reported - could be in a reset loop
+			break;
+		case 2:
+			Log.info("Resetting");
+			resumeCheckpoint.arm(sysStatus.get_lowPowerMode() ? IDLE_STATE : CONNECTING_STATE, sensorsReady);	// Come straight back without the sensor bring-up
+			delay(1000);						// Give the system a second to get the message out
+			System.reset();						// device needs to be reset
+			break;
+		case 3: 
+			Log.info("Powering down");
+			delay(1000);						// Give the system a second to get the message out
+			ab1805.deepPowerDown();				// Power off the device for 30 seconds
+			break;
+		default:								// Ensure we do not get trapped in the ERROR State
+			System.reset();
+			break;
+	}
+}
+
+bool inputEvent(AppContext &ctx, const AppEvent &event) {	// Top level states all handle the user switch and sensor the same way
+	if (event.source == USER_SWITCH_EVENT) {				// If the user switch has been pressed, toggle the sensor module
+		if (event.micros - ctx.lastSwitchMicros < switchDebounceMicros || event.pinState != LOW) return true;	// Bounce - or the switch bouncing on release
+		ctx.lastSwitchMicros = event.micros;
+		digitalWrite(ENABLE_PIN, !digitalRead(ENABLE_PIN));	// Toggle the enable pin
 		Log.info("User switch pressed and Enable pin is now %s", (digitalRead(ENABLE_PIN)) ? "HIGH" : "LOW");
 		delay(1000);	// Give the system a second to get the message out
+		return true;
 	}
-  // End of housekeeping - end of main loop
+	if (event.source == SENSOR_EVENT) {						// Accelerometer interrupt - count lid activity
+		Measure_Trash::instance().clearAccelInterrupt();	// INT1 is latched - the next movement needs a new edge
+		uint32_t sinceLast = event.micros - ctx.lastLidMicros;
+		uint32_t beforeLast = ctx.lastLidMicros - event.micros;	// The ISR's copy of a wake edge can be a little older than the one counted on waking
+		if (ctx.lidActivitySeen && (sinceLast < lidDebounceMicros || beforeLast < lidDebounceMicros)) return true;	// Same opening
+		ctx.lastLidMicros = event.micros;
+		ctx.lidActivitySeen = true;
+		current.set_lidActivity(current.get_lidActivity() + 1);
+		Binary_Log::instance().record(Binary_Log::MSG_LID_ACTIVITY, (unsigned int)current.get_lidActivity(), (unsigned long)sinceLast);
+		if (!sysStatus.get_lowPowerMode()) {				// Show the count - not worth the power when on battery
+			digitalWrite(BLUE_LED, HIGH);
+			countSignalTimer.reset();						// Turns the LED off after a second
+		}
+		return true;
+	}
+	return false;
 }
 /**
  * @brief Publishes a state transition to the Log Handler and to the Particle monitoring system.
  *
- * @details A good debugging tool.
+ * @details A good debugging tool. Also feeds the transition matrix and dwell times in State_Stats and tags
+ * the memory statistics in Memory_Stats with the state.
  */
-void publishStateTransition(void)
+void publishStateTransition(AppContext &, uint8_t from, uint8_t to)
 {
-	char stateTransitionString[256];
-	if (state == IDLE_STATE) {
-		if (!Time.isValid()) snprintf(stateTransitionString, sizeof(stateTransitionString), "From %s to %s with invalid time", stateNames[oldState],stateNames[state]);
-		else snprintf(stateTransitionString, sizeof(stateTransitionString), "From %s to %s", stateNames[oldState],stateNames[state]);
-	}
-	else snprintf(stateTransitionString, sizeof(stateTransitionString), "From %s to %s", stateNames[oldState],stateNames[state]);
-	oldState = state;
-	Log.info(stateTransitionString);
+	if (to == IDLE_STATE && !Time.isValid()) Binary_Log::instance().record(Binary_Log::MSG_STATE_TRANSITION_NO_TIME, from, to);
+	else Binary_Log::instance().record(Binary_Log::MSG_STATE_TRANSITION, from, to);
+	State_Stats::instance().recordTransition(from, to);
+	Memory_Stats::instance().recordTransition(from, to);
 }
 
 // Here are the various hardware and timer interrupt service routines
@@ -422,11 +527,11 @@ void outOfMemoryHandler(system_event_t event, int param) {
 }
 
 void userSwitchISR() {
-  	userSwitchDectected = true;                                          	// The the flag for the user switch interrupt
+  	appMachine.post({USER_SWITCH_EVENT, (uint32_t)micros(), (uint8_t)pinReadFast(BUTTON_PIN)});   	// Queue the user switch event for the main loop
 }
 
 void sensorISR() {
-	sensorDetect = true;													// Set the flag for the sensor interrupt
+	appMachine.post({SENSOR_EVENT, (uint32_t)micros(), (uint8_t)pinReadFast(INT_PIN)});			// Queue the sensor event for the main loop
 }
 
 void countSignalTimerISR() {
@@ -435,17 +540,17 @@ void countSignalTimerISR() {
 
 bool isParkOpen(bool verbose) {
 	conv.withCurrentTime().convert();
-	if (verbose) {
-	  Log.info("Local hour is %i and the park is %s", conv.getLocalTimeHMS().hour, (conv.getLocalTimeHMS().hour < sysStatus.get_openTime() || conv.getLocalTimeHMS().hour > sysStatus.get_closeTime()) ? "closed" : "open");
-	}
-	if (conv.getLocalTimeHMS().hour < sysStatus.get_openTime() || conv.getLocalTimeHMS().hour > sysStatus.get_closeTime()) return false;
-	else return true;
+	int localHour = conv.getLocalTimeHMS().hour;
+	bool open = !(localHour < sysStatus.get_openTime() || localHour > sysStatus.get_closeTime());
+	if (verbose) Binary_Log::instance().record(Binary_Log::MSG_PARK_HOURS, localHour, open);
+	return open;
 }
 
 
 void UbidotsHandler(const char *event, const char *data) {            // Looks at the response from Ubidots - Will reset Photon if no successful response
   char responseString[64];
     // Response is only a single number thanks to Template
+  Binary_Log::instance().trace(Binary_Log::MSG_TRACE_WEBHOOK, atoi(data), (unsigned long)(millis() - appContext.webhookTimeStamp));
   if (!strlen(data)) {                                                // No data in response - Error
     snprintf(responseString, sizeof(responseString),"No Data");
   }
@@ -453,6 +558,7 @@ void UbidotsHandler(const char *event, const char *data) {            // Looks a
     snprintf(responseString, sizeof(responseString),"Response Received");
 	dataInFlight = false;											 // We have received a response - so we can send another
     sysStatus.set_lastHookResponse(Time.now());                          // Record the last successful Webhook Response
+    Alert_Handling::instance().clearEscalation(40);
   }
   else {
     snprintf(responseString, sizeof(responseString), "Unknown response recevied %i",atoi(data));
@@ -460,7 +566,7 @@ void UbidotsHandler(const char *event, const char *data) {            // Looks a
   if (sysStatus.get_verboseMode() && Particle.connected()) {
     Particle.publish("Ubidots Hook", responseString, PRIVATE);
   }
-  Log.info(responseString);
+  Log.info("%s", responseString);
 }
 
 /**
@@ -474,9 +580,35 @@ void dailyCleanup() {
   Log.info("Running Daily Cleanup");
   sysStatus.set_verboseMode(false);                                       			// Saves bandwidth - keep extra chatter off
   sysStatus.set_lowPowerMode(true);
+  State_Stats::instance().dailyReport();                                    // Yesterday's state machine statistics go out with the next connection
+  Memory_Stats::instance().dailyReport();
+  Daily_Stats::instance().dailyReport();
   current.resetEverything();                                                   		// If so, we need to Zero the counts for the new day
 }
 
+/**
+ * @brief Records a failed connection and works out when the hourly report may try again
+ *
+ * @details The wait doubles with each consecutive failure up to connectBackoffMax and is counted from the start
+ * of the attempt that failed, so the first failure still tries again at the next hourly slot.  Not from lastReport -
+ * a connect from setup or the user switch may not have followed a report.  Persisted in
+ * sysStatus so sleeping and resets do not start the backoff over.  A successful connection clears it.
+ */
+void connectionFailed() {
+  uint8_t failures = (sysStatus.get_connectFailures() < 255) ? sysStatus.get_connectFailures() + 1 : 255;
+  time_t backoff = connectBackoffBase;
+
+  for (uint8_t i = 1; i < failures && backoff < connectBackoffMax; i++) backoff *= 2;
+  backoff = min(backoff, connectBackoffMax);
+
+  Daily_Stats::instance().addConnection(sysStatus.get_lastConnectionDuration());   // The radio was on the whole time
+  sysStatus.set_connectFailures(failures);
+  time_t attemptStart = Time.now() - sysStatus.get_lastConnectionDuration();
+  sysStatus.set_nextConnectTime(attemptStart + backoff - 60);            // A minute early so the slot that matches is not skipped
+  Log.info("Connection failed %i times in a row - next try in %i minutes", failures, (int)(backoff / 60));
+  Binary_Log::instance().record(Binary_Log::MSG_CONNECT_BACKOFF, failures, (int)(backoff / 60));
+}
+
 /**
  * @brief soft delay let's us process Particle functions and service the sensor interrupts while pausing
  * 
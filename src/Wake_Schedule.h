@@ -0,0 +1,67 @@
+/*
+ * @file Wake_Schedule.h
+ * @author Chip McClelland (chip@seeinisghts.com)
+ * @brief When to wake up and report - kept free of Particle dependencies so tools/fleet_sim.py can compile the
+ * same code for a Linux host and simulate a whole fleet against the webhook backend.
+ *
+ * @version 0.1
+ * @date 2023-03-25
+ *
+ */
+
+#ifndef __WAKE_SCHEDULE_H
+#define __WAKE_SCHEDULE_H
+
+#include <stdint.h>
+
+namespace Wake_Schedule {
+
+    /**
+     * @brief Seconds to sleep so we wake just after the next reporting boundary
+     *
+     * @param now Time.now()
+     * @param boundary Reporting period in seconds (wakeBoundary)
+     * @param offset Seconds after each boundary to wake - 0 wakes on the boundary itself
+     *
+     * @returns Seconds to sleep - between 2 and boundary + 1
+     */
+    inline int secondsToNextWake(uint32_t now, int boundary, int offset) {
+        int sinceBoundary = (int)((now + (uint32_t)(boundary - offset % boundary)) % (uint32_t)boundary);
+        int wait = boundary - sinceBoundary;
+        if (wait < 1) wait = 1;
+        if (wait > boundary) wait = boundary;
+        return wait + 1;                                // One second past so the hour has rolled over
+    }
+
+    /**
+     * @brief This device's place in the reporting window - spreads the fleet's connects and webhooks out
+     * instead of having every device hit the cellular network and Ubidots in the same second
+     *
+     * @details FNV-1a hash of the device id so the offset is the same after every reset and needs no storage
+     *
+     * @param deviceId System.deviceID()
+     * @param window Seconds after the boundary to spread reports over - 0 for no offset
+     *
+     * @returns Offset in seconds, 0 to window - 1
+     */
+    inline int phaseOffset(const char *deviceId, int window) {
+        uint32_t hash = 0x811C9DC5;
+        if (window <= 0) return 0;
+        while (*deviceId) {
+            hash ^= (uint8_t)*deviceId++;
+            hash *= 0x01000193;
+        }
+        return (int)(hash % (uint32_t)window);
+    }
+
+    /**
+     * @brief Have we reached this device's slot in the current period
+     *
+     */
+    inline bool inReportSlot(uint32_t now, int boundary, int offset) {
+        return (int)(now % (uint32_t)boundary) >= offset;
+    }
+
+}
+
+#endif  /* __WAKE_SCHEDULE_H */
@@ -11,8 +11,8 @@
  * 3.3V -
  * !MODE -
  * GND -
- * D19 - A0 -               
- * D18 - A1 -                  
+ * D19 - A0 -               XSHUT for the 4th VL53L1X (large containers)
+ * D18 - A1 -               GPIO for the primary VL53L1X - autonomous ranging interrupt
  * D17 - A2 -                         
  * D16 - A3 -               
  * D15 - A4 -               
@@ -29,10 +29,10 @@
  * VUSB -
  * D8 -                     Wake Connected to Watchdog Timer
  * D7 -                     Blue Led
- * D6 -                     
- * D5 -                     
+ * D6 -                     XSHUT for the 3rd VL53L1X (large containers)
+ * D5 -                     XSHUT for the 2nd VL53L1X (large containers)
  * D4 -                     User Switch
- * D3 -                     GPIO for the VL53L1X   
+ * D3 -                     Accelerometer INT1 - movement interrupt
  * D2 -                     Shutdown pin for the VL53L1X       
  * D1 - SCL - I2C Clock -   FRAM / RTC and I2C Bus - and TOF / Accelerometer Sensor
  * D0 - SDA - I2C Data -    FRAM / RTX and I2C Bus - and TOF / Accelerometer Sensor
@@ -45,8 +45,11 @@ const pin_t BLUE_LED          = D7;
 const pin_t WAKEUP_PIN        = D8;
 
 // Sensor specific Pins
-extern const pin_t INT_PIN =  D3;                      // for Accelerometer
+extern const pin_t INT_PIN =  D3;                      // Accelerometer INT1 - push-pull, so nothing else may drive it
+extern const pin_t TOF_INT_PIN = A1;                   // Primary VL53L1X GPIO1 - its own line, the accelerometer drives INT_PIN
 extern const pin_t ENABLE_PIN = D2;                    // Bring low to enable the module - resets device
+extern const pin_t TOF_XSHUT_PINS[] = {D5, D6, A0};    // Extra TOF sensors on big containers - fitted in this order, held in reset until addressed
+extern const uint8_t TOF_XSHUT_COUNT = sizeof(TOF_XSHUT_PINS) / sizeof(TOF_XSHUT_PINS[0]);
 
 
 bool initializePinModes() {
@@ -55,10 +58,15 @@ bool initializePinModes() {
     pinMode(BUTTON_PIN,INPUT);               // User button on the carrier board - active LOW
     pinMode(WAKEUP_PIN,INPUT);                      // This pin is active HIGH
     pinMode(BLUE_LED,OUTPUT);                       // On the Boron itself
-    pinMode(INT_PIN, INPUT);                        // Interrupt pin for the Magnetometer
+    pinMode(INT_PIN, INPUT);                        // Accelerometer movement interrupt
+    pinMode(TOF_INT_PIN, INPUT);                    // TOF fill band interrupt - only armed in autonomous ranging
     pinMode(ENABLE_PIN,OUTPUT);                     // Bring low to enable the module
     pinSetDriveStrength(ENABLE_PIN, DriveStrength::HIGH);          // Set the drive strength to high to drive the FET
     digitalWrite(ENABLE_PIN, LOW);					// Turns on the module
+    for (uint8_t i = 0; i < TOF_XSHUT_COUNT; i++) {
+        pinMode(TOF_XSHUT_PINS[i], OUTPUT);
+        digitalWrite(TOF_XSHUT_PINS[i], LOW);       // Extra TOF sensors stay in reset until Measure_Trash gives them an address
+    }
     return true;
 }
 
@@ -18,7 +18,10 @@ extern const pin_t INTERNAL_TEMP_PIN;
 
 // Specific to the sensor
 extern const pin_t INT_PIN;
+extern const pin_t TOF_INT_PIN;
 extern const pin_t ENABLE_PIN;
+extern const pin_t TOF_XSHUT_PINS[];
+extern const uint8_t TOF_XSHUT_COUNT;
 
 bool initializePinModes();
 bool initializePowerCfg();
@@ -6,6 +6,8 @@
 #include "math.h"
 #include "Take_Measurements.h"
 #include "Measure_Trash.h"
+#include "Binary_Log.h"
+#include "Daily_Stats.h"
 
 FuelGauge fuelGauge;                                // Needed to address issue with updates in low battery state
 
@@ -36,19 +38,31 @@ void Take_Measurements::loop() {
 
 bool Take_Measurements::takeMeasurements() { 
 
-    Measure_Trash::instance().measureHeight();                         // Measure the height of the trash in the trashcan
+    Measurement reading = current.measurement();                        // Built up here and committed as one unit - readers never see half of it
 
-    current.set_batteryVoltage(fuelGauge.getVCell());                  // Get the battery voltage
-    Log.info("Battery voltage is %4.2f",current.get_batteryVoltage());
+    readSensors(reading);
 
     if (Particle.connected()) getSignalStrength();
 
-    current.set_internalTempC((analogRead(INTERNAL_TEMP_PIN) * 3.3 / 4096.0 - 0.5) * 100.0);  // 10mV/degC, 0.5V @ 0degC
-    Log.info("Internal Temp: %4.2fC",current.get_internalTempC());
+    reading.lastMeasureTime = Time.now();                              // Age stamp - commands answer from these readings while they are fresh
+    current.commitMeasurement(reading);
+    Daily_Stats::instance().addMeasurement(reading);                   // Running totals for the daily record
 
     return 1;
 }
 
+void Take_Measurements::readSensors(Measurement &reading) {
+    reading.internalTempC = (analogRead(INTERNAL_TEMP_PIN) * 3.3 / 4096.0 - 0.5) * 100.0;  // 10mV/degC, 0.5V @ 0degC - first as the TOF compensation uses it
+    Binary_Log::instance().record(Binary_Log::MSG_INTERNAL_TEMP, reading.internalTempC);
+
+    Measure_Trash::instance().measureHeight(reading);                  // Measure the height of the trash in the trashcan
+
+    float vCell = fuelGauge.getVCell();                                // Get the battery voltage
+    Binary_Log::instance().trace(Binary_Log::MSG_TRACE_VCELL, vCell);
+    reading.batteryVoltage = vCell;
+    Binary_Log::instance().record(Binary_Log::MSG_BATTERY, reading.batteryVoltage);
+}
+
 void Take_Measurements::getSignalStrength() {
   char signalStr[16];
   const char* radioTech[10] = {"Unknown","None","WiFi","GSM","UMTS","CDMA","LTE","IEEE802154","LTE_CAT_M1","LTE_CAT_NB1"};
@@ -64,7 +78,7 @@ void Take_Measurements::getSignalStrength() {
   float qualityPercentage = sig.getQuality();
 
   snprintf(signalStr,sizeof(signalStr), "%s S:%2.0f%%, Q:%2.0f%% ", radioTech[rat], strengthPercentage, qualityPercentage);
-  Log.info(signalStr);
+  Log.info("%s", signalStr);
 }
 
 float Take_Measurements::getTemperature(int reading) {                                     // Get temperature and make sure we are not getting a spurrious value
@@ -13,6 +13,7 @@
 #define __TAKE_MEASUREMENTS_H
 
 #include "Particle.h"
+#include "Measurement_Snapshot.h"
 
 /**
  * This class is a singleton; you do not create one as a global, on the stack, or with new.
@@ -56,6 +57,16 @@ public:
      */
     bool takeMeasurements();                               // Function that calls the needed functions in turn
 
+    /**
+     * @brief Reads the sensors into reading - internal temperature, trash height, lid and battery
+     * 
+     * @details Nothing is committed to current or added to the daily stats, so the benchmark can time the reads
+     * on a scratch Measurement.  The trashcan emptied test (and the TOF learning it triggers) compares against
+     * reading's percentFull.
+     * 
+     */
+    void readSensors(Measurement &reading);
+
     /**
      * @brief tmp36TemperatureC
      * 
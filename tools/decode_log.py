@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+"""
+Decodes Binary_Log records pulled from a device with {"cmd":[{"var":"resume","fn":"log"}]}
+
+The format strings and string tables are read straight from the firmware sources so the decoder always
+matches the firmware it is run from.
+
+Usage: decode_log.py [--csv | --trace] <file with one "log" event data JSON per line>   (reads stdin if no file)
+
+--trace writes only the "Trace ..." records (turned on with {"cmd":[{"var":"on","fn":"trace"}]}) as JSON lines,
+one input per line with its decoded arguments - the raw TOF, accelerometer, VCell, connect and webhook inputs
+the device acted on, in the order it saw them.
+"""
+
+import json
+import re
+import struct
+import sys
+import time
+from pathlib import Path
+
+SRC = Path(__file__).resolve().parent.parent / "src"
+RECORD = struct.Struct("<IBBH4I")                   # Binary_Log::Record - 24 bytes, little endian
+
+
+def load_tables():
+    text = "".join(p.read_text() for p in SRC.glob("*.cpp"))
+    tables = {}
+    for name, body in re.findall(r"const char \* const (\w+)\[\] = \{(.*?)\};", text, re.S):
+        tables[name] = re.findall(r'"((?:[^"\\]|\\.)*)"', body)
+    formats_body = re.search(r"messageFormats\[\] = \{(.*?)\n  \};", text, re.S).group(1)
+    formats = []
+    for fmt, strings in re.findall(r'\{"((?:[^"\\]|\\.)*)", (\w+), \d+\}', formats_body):
+        formats.append((fmt.replace('\\"', '"'), tables.get(strings, [])))
+    return formats
+
+
+SPEC = re.compile(r"([^%]*)(%%|%[-+ #0-9.]*l?[diuxXcsfeEgG])?")
+
+
+def decode_arg(spec, strings, arg):
+    conversion = spec[-1]
+    if conversion == "s":
+        return strings[arg] if arg < len(strings) else "?"
+    if conversion in "feEgG":
+        return struct.unpack("<f", struct.pack("<I", arg))[0]
+    if conversion in "uxX":
+        return arg
+    return struct.unpack("<i", struct.pack("<I", arg))[0]
+
+
+def trace_record(formats, timestamp, sequence, rec_id, args):
+    """Returns the trace input as a dict or None if this is not a trace record"""
+    if rec_id >= len(formats) or not formats[rec_id][0].startswith("Trace "):
+        return None
+    fmt, strings = formats[rec_id]
+    specs = [spec for _, spec in SPEC.findall(fmt) if spec and spec != "%%"]
+    return {
+        "timestamp": timestamp,
+        "sequence": sequence,
+        "type": fmt.split()[1].lower(),
+        "args": [decode_arg(spec, strings, arg) for spec, arg in zip(specs, args)],
+    }
+
+
+def format_record(formats, rec_id, args):
+    if rec_id >= len(formats):
+        return "Unknown message %d" % rec_id
+    fmt, strings = formats[rec_id]
+    out, index = [], 0
+    for literal, spec in SPEC.findall(fmt):
+        out.append(literal)
+        if not spec:
+            continue
+        if spec == "%%":
+            out.append("%")
+            continue
+        arg = args[index] if index < len(args) else 0
+        index += 1
+        if spec[-1] == "s":
+            out.append(decode_arg(spec, strings, arg))
+        else:
+            out.append(spec.replace("l", "").replace("u", "d") % decode_arg(spec, strings, arg))
+    return "".join(out)
+
+
+def main():
+    csv = "--csv" in sys.argv
+    trace = "--trace" in sys.argv
+    paths = [a for a in sys.argv[1:] if not a.startswith("--")]
+    lines = open(paths[0]).readlines() if paths else sys.stdin.readlines()
+    formats = load_tables()
+    if csv:
+        print("timestamp,sequence,id,arg0,arg1,arg2,arg3")
+    for line in lines:
+        line = line.strip()
+        if not line:
+            continue
+        chunk = json.loads(line)
+        raw = bytes.fromhex(chunk["records"])
+        for offset in range(0, len(raw) - RECORD.size + 1, RECORD.size):
+            timestamp, rec_id, argc, sequence, *args = RECORD.unpack_from(raw, offset)
+            if trace:
+                entry = trace_record(formats, timestamp, sequence, rec_id, args[:argc])
+                if entry:
+                    print(json.dumps(entry))
+                continue
+            if csv:
+                print(",".join(str(v) for v in [timestamp, sequence, rec_id] + args))
+                continue
+            stamp = time.strftime("%Y-%m-%d %H:%M:%S", time.gmtime(timestamp))
+            print("%s #%05d %s" % (stamp, sequence, format_record(formats, rec_id, args[:argc])))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,234 @@
+#!/usr/bin/env python3
+"""
+Fleet scale simulator for the hourly report - how hard does a fleet of cans hit the Ubidots webhook, and what
+does each reporting policy cost the devices in energy.
+
+Each simulated can is built from the firmware: tools/host/fleet_node.so (make -C tools/host fleet_node.so) holds
+the wake schedule in src/Wake_Schedule.h, Measure_TrashT with the mock sensors and the webhook payload formatter
+in src/Event_Payload.h, called through ctypes.  Devices are split across all cores; each one runs on a virtual
+clock (sleep -> wake -> connect -> publish -> stay awake) and POSTs the payload it builds to a local HTTP server
+standing in for the webhook.  The server checks each payload parses and queues it, by its virtual arrival time,
+through a model of the backend with a fixed number of workers.
+
+Modeled rather than taken from the firmware: the radio - connect times are drawn from a long tailed
+distribution - and the fill level, temperature and battery the mock sensors report.
+
+Policies:
+  aligned   every device wakes on the hour
+  jitter    a fresh random offset within --spread on every wake
+  phased    a fixed offset within --spread derived from the device id (Wake_Schedule::phaseOffset, the firmware)
+
+Usage: fleet_sim.py [--devices 1000] [--days 1] [--policy aligned,jitter,phased] [--spread 600]
+                    [--workers 4] [--service-ms 250] [--seed 1]
+"""
+
+import argparse
+import ctypes
+import heapq
+import http.client
+import http.server
+import json
+import multiprocessing
+import os
+import random
+import subprocess
+import threading
+from pathlib import Path
+
+HOST = Path(__file__).resolve().parent / "host"
+WAKE_BOUNDARY = 3600                                # wakeBoundary in Trashcan-Panda.cpp
+STAY_AWAKE_LONG = 90                                # stayAwakeLong - seconds awake after reporting
+STAY_AWAKE_SHORT = 1                                # stayAwakeShort - seconds awake when not reporting
+WEBHOOK_WAIT = 45                                   # webhookWait - a response slower than this raises alert 40
+SLEEP_MA = 0.1                                      # ULTRA_LOW_POWER with the sensors off
+AWAKE_MA = 15.0                                     # Awake, modem off
+CONNECTED_MA = 90.0                                 # Modem on, connecting or connected
+EMPTY_MM = 965                                      # trashEmpty (38") - the TOF distance to the bottom of the can
+FULL_MM = 229                                       # trashFull (9")
+
+_node = None
+
+
+def build_node():
+    subprocess.check_call(["make", "-s", "-C", str(HOST), "fleet_node.so"])
+    return str(HOST / "fleet_node.so")
+
+
+def load_node(library):
+    global _node
+    _node = ctypes.CDLL(library)
+    _node.secondsToNextWake.argtypes = [ctypes.c_uint, ctypes.c_int, ctypes.c_int]
+    _node.secondsToNextWake.restype = ctypes.c_int
+    _node.phaseOffset.argtypes = [ctypes.c_char_p, ctypes.c_int]
+    _node.phaseOffset.restype = ctypes.c_int
+    _node.nodeReset.argtypes = []
+    _node.nodeReset.restype = None
+    _node.nodeReport.argtypes = [ctypes.c_int, ctypes.c_float, ctypes.c_float, ctypes.c_int, ctypes.c_ulong,
+                                 ctypes.c_char_p, ctypes.c_int]
+    _node.nodeReport.restype = ctypes.c_int
+
+
+class Webhook(http.server.ThreadingHTTPServer):
+    """Local stand-in for the webhook - keeps each policy's arrivals (virtual seconds) and the payloads that did not parse"""
+
+    daemon_threads = True
+
+    def __init__(self):
+        super().__init__(("127.0.0.1", 0), WebhookHandler)
+        self.lock = threading.Lock()
+        self.arrivals = {}
+        self.bad = {}
+
+    def take(self, policy):
+        with self.lock:
+            return sorted(self.arrivals.pop(policy, [])), self.bad.pop(policy, 0)
+
+
+class WebhookHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"                   # Keep-alive - a node posts its whole run on one connection
+
+    def do_POST(self):
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        policy = self.path.strip("/")
+        try:
+            json.loads(body)
+            ok = True
+        except ValueError:
+            ok = False
+        with self.server.lock:
+            self.server.arrivals.setdefault(policy, []).append(float(self.headers["X-Sim-Time"]))
+            if not ok:
+                self.server.bad[policy] = self.server.bad.get(policy, 0) + 1
+        self.send_response(200 if ok else 400)
+        self.send_header("Content-Length", "0")
+        self.end_headers()
+
+    def log_message(self, format, *args):
+        pass
+
+
+def simulate_devices(args):
+    """Runs one chunk of devices, posting their payloads to the webhook - returns their energy use"""
+    first, count, policy, days, spread, seed, port = args
+    start = 1672531200                              # Midnight UTC - any midnight will do
+    end = start + days * 86400
+    webhook = http.client.HTTPConnection("127.0.0.1", port)
+    payload = ctypes.create_string_buffer(256)
+    energy = []
+    for device in range(first, first + count):
+        rng = random.Random(seed * 1000003 + device)
+        device_id = "e00fce68%016x" % device
+        now = start + rng.randrange(WAKE_BOUNDARY)  # Devices were powered up at different times
+        fill = rng.uniform(0, 50)                   # Percent
+        _node.nodeReset()
+        mah = 0.0
+        last_report = 0
+        while now < end:
+            if policy == "aligned":
+                offset = 0
+            elif policy == "jitter":
+                offset = rng.randrange(spread) if spread else 0
+            else:
+                offset = _node.phaseOffset(device_id.encode(), spread)
+            sleep = _node.secondsToNextWake(now, WAKE_BOUNDARY, offset)
+            now += sleep
+            mah += sleep * SLEEP_MA / 3600
+            if now // WAKE_BOUNDARY == last_report // WAKE_BOUNDARY or now % WAKE_BOUNDARY < offset:   # Not our turn - back to sleep
+                mah += STAY_AWAKE_SHORT * AWAKE_MA / 3600
+                now += STAY_AWAKE_SHORT
+                continue
+            last_report = now
+            connect = min(rng.lognormvariate(3.0, 0.5), 600)      # Seconds - median ~20s, long tail
+            fill = 5.0 if fill > 90 or rng.random() < 0.05 else fill + rng.uniform(0, 8)
+            distance = int(EMPTY_MM - fill / 100 * (EMPTY_MM - FULL_MM))
+            length = _node.nodeReport(distance, rng.gauss(20, 5), 4.1 - rng.uniform(0, 0.3), int(connect),
+                                      now - now % WAKE_BOUNDARY - 1, payload, len(payload))
+            webhook.request("POST", "/" + policy, body=payload.raw[:length],
+                            headers={"Content-Type": "application/json", "X-Sim-Time": "%.3f" % (now + connect)})
+            webhook.getresponse().read()
+            mah += connect * CONNECTED_MA / 3600 + STAY_AWAKE_LONG * CONNECTED_MA / 3600 + 2 * AWAKE_MA / 3600
+            now += int(connect) + STAY_AWAKE_LONG
+        energy.append(mah / days)
+    webhook.close()
+    return energy
+
+
+def backend(arrivals, workers, service):
+    """First come first served with a fixed pool of workers - returns the per request waits and peak backlog"""
+    free = [0.0] * workers
+    waits, backlog, peak_backlog = [], [], 0
+    for arrival in arrivals:
+        while backlog and backlog[0] <= arrival:
+            heapq.heappop(backlog)
+        start = max(arrival, heapq.heappop(free))
+        heapq.heappush(free, start + service)
+        heapq.heappush(backlog, start)              # Waiting in the queue until it starts
+        peak_backlog = max(peak_backlog, len(backlog))
+        waits.append(start + service - arrival)
+    return waits, peak_backlog
+
+
+def percentile(values, fraction):
+    return values[min(len(values) - 1, int(len(values) * fraction))] if values else 0
+
+
+def run_policy(pool, webhook, policy, opts):
+    chunk = max(1, opts.devices // (os.cpu_count() * 4))
+    jobs = [(first, min(chunk, opts.devices - first), policy, opts.days, opts.spread, opts.seed,
+             webhook.server_address[1]) for first in range(0, opts.devices, chunk)]
+    energy = []
+    for chunk_energy in pool.map(simulate_devices, jobs):
+        energy.extend(chunk_energy)
+    arrivals, bad = webhook.take(policy)
+
+    per_second, per_minute = {}, {}
+    for arrival in arrivals:
+        per_second[int(arrival)] = per_second.get(int(arrival), 0) + 1
+        per_minute[int(arrival) // 60] = per_minute.get(int(arrival) // 60, 0) + 1
+    waits, peak_backlog = backend(arrivals, opts.workers, opts.service_ms / 1000)
+    waits.sort()
+    energy.sort()
+    return {
+        "policy": policy,
+        "requests": len(arrivals),
+        "bad": bad,
+        "peak/s": max(per_second.values(), default=0),
+        "peak/min": max(per_minute.values(), default=0),
+        "backlog": peak_backlog,
+        "p50 wait": percentile(waits, 0.5),
+        "p99 wait": percentile(waits, 0.99),
+        "timeouts": sum(1 for wait in waits if wait > WEBHOOK_WAIT),
+        "mAh/day": sum(energy) / len(energy) if energy else 0,
+        "max mAh/day": energy[-1] if energy else 0,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--devices", type=int, default=1000)
+    parser.add_argument("--days", type=int, default=1)
+    parser.add_argument("--policy", default="aligned,jitter,phased")
+    parser.add_argument("--spread", type=int, default=600, help="seconds after the hour to spread reports over")
+    parser.add_argument("--workers", type=int, default=4, help="concurrent webhook requests the backend handles")
+    parser.add_argument("--service-ms", type=float, default=250, help="backend time per request")
+    parser.add_argument("--seed", type=int, default=1)
+    opts = parser.parse_args()
+
+    library = build_node()
+    with multiprocessing.Pool(initializer=load_node, initargs=(library,)) as pool:
+        webhook = Webhook()                         # After the pool forks - the workers only connect to it
+        threading.Thread(target=webhook.serve_forever, daemon=True).start()
+        results = [run_policy(pool, webhook, policy, opts) for policy in opts.policy.split(",")]
+        webhook.shutdown()
+
+    print("%-8s %9s %5s %7s %9s %8s %9s %9s %9s %8s %12s" % ("policy", "requests", "bad", "peak/s", "peak/min",
+                                                              "backlog", "p50 wait", "p99 wait", "timeouts", "mAh/day",
+                                                              "max mAh/day"))
+    for r in results:
+        print("%-8s %9d %5d %7d %9d %8d %8.1fs %8.1fs %9d %8.2f %12.2f" % (
+            r["policy"], r["requests"], r["bad"], r["peak/s"], r["peak/min"], r["backlog"], r["p50 wait"],
+            r["p99 wait"], r["timeouts"], r["mAh/day"], r["max mAh/day"]))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,50 @@
+#include "Host_Support.h"
+
+unsigned long hostMillis = 0;
+HostLogger Log;
+HostSysStatus hostSysStatus;
+HostTofCal hostTofCal;
+std::vector<Binary_Log::Record> hostLog;
+
+void hostReset() {
+  hostMillis = 0;
+  hostSysStatus = HostSysStatus();
+  hostTofCal = HostTofCal();
+  hostLog.clear();
+}
+
+size_t hostLogCount(Binary_Log::MessageId id) {
+  size_t count = 0;
+  for (const Binary_Log::Record &rec : hostLog) if (rec.id == id) count++;
+  return count;
+}
+
+// Binary_Log - records go to hostLog instead of the RAM and FRAM rings
+Binary_Log *Binary_Log::_instance;
+
+Binary_Log &Binary_Log::instance() {
+  if (!_instance) {
+      _instance = new Binary_Log();
+  }
+  return *_instance;
+}
+
+Binary_Log::Binary_Log() : mutex(nullptr) {
+}
+
+Binary_Log::~Binary_Log() {
+}
+
+void Binary_Log::setTracing(bool enable) {
+  tracing = enable;
+}
+
+void Binary_Log::write(MessageId id, const uint32_t *args, uint8_t argCount) {
+  Record rec = {};
+  rec.timestamp = (uint32_t)(hostMillis / 1000);
+  rec.id = id;
+  rec.argCount = argCount;
+  rec.sequence = head++;
+  memcpy(rec.args, args, argCount * sizeof(uint32_t));
+  hostLog.push_back(rec);
+}
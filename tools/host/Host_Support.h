@@ -0,0 +1,70 @@
+/*
+ * @file Host_Support.h
+ * @brief Host stand-ins for the FRAM objects Measure_Trash uses and a Binary_Log that keeps its records in a vector.
+ *
+ * @details Include this before src/Measure_Trash.cpp - it takes the include guard of MyPersistentData.h, so the
+ * firmware header (StorageHelperRK, the FRAM driver) is skipped and the sysStatus and tofCal macros name these.
+ *
+ */
+
+#ifndef __HOST_SUPPORT_H
+#define __HOST_SUPPORT_H
+
+#define __MYPERSISTENTDATA_H
+
+#include "Particle.h"
+#include "Binary_Log.h"
+#include <vector>
+
+struct HostSysStatus {
+    int trashFull = 9;                                  // sysStatusData::initialize() defaults
+    int trashEmpty = 38;
+    bool tofAutonomous = false;
+    uint8_t tofFusion = 0;
+
+    int get_trashFull() const { return trashFull; }
+    int get_trashEmpty() const { return trashEmpty; }
+    bool get_tofAutonomous() const { return tofAutonomous; }
+    uint8_t get_tofFusion() const { return tofFusion; }
+};
+
+struct HostTofCal {
+    struct Fit {                                        // tofCalData::Fit
+        float samples;
+        float sumT;
+        float sumE;
+        float sumTT;
+        float sumTE;
+        float referenceMm;
+    };
+
+    float calTempC = NAN;
+    Fit fit = {};
+
+    float get_calTempC() const { return calTempC; }
+    void set_calTempC(float value) { calTempC = value; }
+    Fit get_fit() const { return fit; }
+    void set_fit(const Fit &value) { fit = value; }
+};
+
+extern HostSysStatus hostSysStatus;
+extern HostTofCal hostTofCal;
+#define sysStatus hostSysStatus
+#define tofCal hostTofCal
+typedef HostTofCal tofCalData;
+
+extern std::vector<Binary_Log::Record> hostLog;         // Everything Binary_Log::record() was given, oldest first
+
+/**
+ * @brief Back to a freshly initialized device - defaults, empty log, clock at zero
+ *
+ */
+void hostReset();
+
+/**
+ * @brief How many records with this id are in hostLog
+ *
+ */
+size_t hostLogCount(Binary_Log::MessageId id);
+
+#endif  /* __HOST_SUPPORT_H */
@@ -0,0 +1,36 @@
+/*
+ * @file MB85RC256V-FRAM-RK.h
+ * @brief Host stand-in for the FRAM driver - the memory is a RAM array, so StorageHelperRK's PersistentDataFRAM
+ * builds and saves on the host.  Shadows lib/MB85RC256V-FRAM-RK on the include path of the host builds.
+ *
+ */
+
+#ifndef __MB85RC256V_FRAM_RK
+#define __MB85RC256V_FRAM_RK
+
+#include "Particle.h"
+#include <vector>
+
+class MB85RC {
+public:
+    explicit MB85RC(size_t memorySize) : memory(memorySize, 0) {}
+
+    size_t length() const { return memory.size(); }
+
+    bool readData(size_t framAddr, uint8_t *data, size_t dataLen) {
+        if (framAddr + dataLen > memory.size()) return false;
+        memcpy(data, &memory[framAddr], dataLen);
+        return true;
+    }
+
+    bool writeData(size_t framAddr, const uint8_t *data, size_t dataLen) {
+        if (framAddr + dataLen > memory.size()) return false;
+        memcpy(&memory[framAddr], data, dataLen);
+        return true;
+    }
+
+private:
+    std::vector<uint8_t> memory;
+};
+
+#endif  /* __MB85RC256V_FRAM_RK */
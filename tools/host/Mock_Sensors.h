@@ -0,0 +1,127 @@
+/*
+ * @file Mock_Sensors.h
+ * @brief Scripted range and tilt sensor policies for Measure_TrashT on the host - see Fill_Sensors.h for the members
+ * a policy provides.  Measure_TrashT owns its sensors, so what they return and what was asked of them is kept in
+ * static members the harness can set and check.
+ *
+ */
+
+#ifndef __MOCK_SENSORS_H
+#define __MOCK_SENSORS_H
+
+#include "Particle.h"
+#include "Fill_Sensors.h"
+
+class MockRange {
+public:
+    static const uint8_t MAX_SENSORS = 4;
+
+    // Script - what the sensors report
+    static inline uint8_t fitted = 1;                   // Sensors begin() finds
+    static inline bool ready = true;                    // Results arrive once ranging starts
+    static inline uint8_t good = 1;                     // Results read() returns - up to the sensors found
+    static inline uint16_t mm[MAX_SENSORS] = {};
+    static inline uint16_t signalRate[MAX_SENSORS] = {};
+
+    // What Measure_TrashT did with them
+    static inline unsigned begins = 0;
+    static inline unsigned standbys = 0;
+    static inline unsigned temperatureUpdates = 0;
+    static inline bool armed = false;
+    static inline uint16_t lowMm = 0;
+    static inline uint16_t highMm = 0;
+
+    static void reset() {
+        fitted = 1;
+        ready = true;
+        good = 1;
+        memset(mm, 0, sizeof(mm));
+        memset(signalRate, 0, sizeof(signalRate));
+        begins = standbys = temperatureUpdates = 0;
+        armed = false;
+        lowMm = highMm = 0;
+        found = 0;
+        ranging = false;
+    }
+
+    uint8_t begin() { begins++; found = fitted; return found; }
+
+    bool responding() { return found > 0 && found == fitted; }
+
+    uint8_t count() const { return found; }
+
+    void temperatureUpdate() { temperatureUpdates++; }
+
+    void startRanging() { ranging = true; }
+
+    bool dataReady() { return ranging && ready; }
+
+    uint8_t read(uint16_t *readMm, uint16_t *readRate) {
+        if (!dataReady()) return 0;
+        uint8_t n = (good < found) ? good : found;
+        memcpy(readMm, mm, n * sizeof(uint16_t));
+        memcpy(readRate, signalRate, n * sizeof(uint16_t));
+        return n;
+    }
+
+    void standby() { ranging = false; standbys++; }
+
+    void armThresholds(uint16_t low, uint16_t high, uint16_t) { armed = true; lowMm = low; highMm = high; }
+
+    void disarmThresholds() { armed = false; }
+
+private:
+    static inline uint8_t found = 0;
+    static inline bool ranging = false;
+};
+
+class MockTilt {
+public:
+    static const unsigned long SETTLE_MS = 20;
+
+    // Script - 1g is about 16000
+    static inline bool present = true;
+    static inline int16_t x = 0;
+    static inline int16_t y = 0;
+    static inline int16_t z = 16000;
+    static inline bool latched = false;                 // Movement seen in the sleep profile and not yet cleared
+
+    // What Measure_TrashT did with it
+    static inline AccelProfile profile = ACCEL_PROFILE_COUNT;
+    static inline unsigned profileChanges = 0;
+
+    static void reset() {
+        present = true;
+        x = y = 0;
+        z = 16000;
+        profile = ACCEL_PROFILE_COUNT;
+        profileChanges = 0;
+        latched = false;
+    }
+
+    bool setProfile(AccelProfile newProfile) {
+        if (!present) return false;
+        profile = newProfile;
+        profileChanges++;
+        latched = false;
+        return true;
+    }
+
+    uint8_t clearInterrupt() {
+        uint8_t source = latched ? 0x40 : 0;            // LIS3DH::INT1_SRC_IA
+        latched = false;
+        return source;
+    }
+
+    void logProfiles() {}
+
+    bool getSample(int16_t &sx, int16_t &sy, int16_t &sz) {
+        if (!present || profile != ACCEL_SAMPLE) return false;   // Only sampled in the full rate window
+        sx = x;
+        sy = y;
+        sz = z;
+        return true;
+    }
+};
+
+#endif  /* __MOCK_SENSORS_H */
@@ -0,0 +1,99 @@
+/*
+ * @file Particle.h
+ * @brief Host stand-in for the parts of Device OS that the sensor code uses - a virtual millisecond clock,
+ * Log to stderr, no-op mutexes and enough of the Wiring String and WITH_LOCK for the JSON parser and
+ * StorageHelperRK (built with UNITTEST).  Only on the include path of the host builds in tools/host.
+ *
+ */
+
+#ifndef __HOST_PARTICLE_H
+#define __HOST_PARTICLE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+typedef uint16_t pin_t;
+typedef void *os_mutex_t;
+typedef void *os_thread_t;
+
+inline void os_mutex_lock(os_mutex_t) {}
+inline void os_mutex_unlock(os_mutex_t) {}
+
+// Holds lockable's lock() for the statement that follows, as the Device OS macro does
+#define WITH_LOCK(lockable) \
+    for (bool hostOnce = true; hostOnce; ) \
+        for (std::lock_guard<typename std::remove_reference<decltype(lockable)>::type> hostGuard(lockable); hostOnce; hostOnce = false)
+
+// Virtual clock - delay() moves it on instead of waiting
+extern unsigned long hostMillis;
+inline unsigned long millis() { return hostMillis; }
+inline unsigned long micros() { return hostMillis * 1000UL; }
+inline void delay(unsigned long ms) { hostMillis += ms; }
+
+template <typename T, typename U, typename V>
+inline T constrain(T value, U low, V high) { return (value < low) ? low : (value > high) ? high : value; }
+
+// The Wiring String calls the libraries make - backed by std::string
+class String {
+public:
+    String() {}
+    String(const char *cstr) : value(cstr ? cstr : "") {}
+
+    const char *c_str() const { return value.c_str(); }
+    operator const char *() const { return value.c_str(); }
+    unsigned int length() const { return value.length(); }
+    bool reserve(unsigned int size) { value.reserve(size); return true; }
+    bool concat(char c) { value += c; return true; }
+    String &operator+=(char c) { value += c; return *this; }
+    String &operator+=(const char *cstr) { value += cstr; return *this; }
+    bool operator==(const char *cstr) const { return value == cstr; }
+    char operator[](unsigned int index) const { return value[index]; }
+
+private:
+    std::string value;
+};
+
+class HostLogger {
+public:
+    bool verbose = false;                               // Set by the harness from -v
+
+    void info(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        vlog(fmt, args);
+        va_end(args);
+    }
+
+    void trace(const char *fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        vlog(fmt, args);
+        va_end(args);
+    }
+
+    void print(const char *text) {
+        if (verbose) fputs(text, stderr);
+    }
+
+    void dump(const void *data, size_t len) {
+        if (!verbose) return;
+        for (size_t i = 0; i < len; i++) fprintf(stderr, "%02x", ((const uint8_t *)data)[i]);
+    }
+
+private:
+    void vlog(const char *fmt, va_list args) {
+        if (!verbose) return;
+        vfprintf(stderr, fmt, args);
+        fputc('\n', stderr);
+    }
+};
+extern HostLogger Log;
+
+#endif  /* __HOST_PARTICLE_H */
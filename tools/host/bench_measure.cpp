@@ -0,0 +1,186 @@
+/*
+ * @file bench_measure.cpp
+ * @brief Host side of the "bench" command - times the measurement pipeline's own code with the mock sensors, so
+ * the sensor and I2C time the device benchmark includes is left out.  The command parse, webhook payload and FRAM
+ * save steps run the same library and firmware code as on the device, the FRAM being a RAM array here.  Reports
+ * nanoseconds and, on x86, TSC cycles as a min / avg / max table like Benchmark::run().
+ *
+ * Usage: make -C tools/host bench [ITERATIONS=10000]
+ *
+ */
+
+#include "Host_Support.h"
+#include "Mock_Sensors.h"
+#include "Measure_Trash.cpp"                              // Template members are defined there
+#include "Event_Payload.h"
+#include "JsonParserGeneratorRK.h"
+#include "MB85RC256V-FRAM-RK.h"                           // The RAM stand-in in this directory
+#include "StorageHelperRK.h"
+#include <stdlib.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+template class Measure_TrashT<MockRange, MockTilt>;
+typedef Measure_TrashT<MockRange, MockTilt> MockMeasure;
+
+namespace {
+  Measurement reading;
+
+  void setupSensors(uint8_t sensors, uint8_t fusion) {
+    hostReset();
+    MockRange::reset();
+    MockTilt::reset();
+    MockRange::fitted = sensors;
+    MockRange::good = sensors;
+    hostSysStatus.tofFusion = fusion;
+    MockMeasure::instance().setup();
+    reading = Measurement();
+    reading.internalTempC = 25.0;
+  }
+
+  void benchOneSensor() {
+    MockRange::mm[0] = 600;
+    MockMeasure::instance().measureHeight(reading);
+  }
+
+  void benchFourSensors() {
+    for (uint8_t i = 0; i < MockRange::MAX_SENSORS; i++) {       // measureHeight() sorts them in place
+      MockRange::mm[i] = 400 + 97 * ((i * 3) % MockRange::MAX_SENSORS);
+      MockRange::signalRate[i] = 50 + i;
+    }
+    MockMeasure::instance().measureHeight(reading);
+  }
+
+  void benchTemperatureCorrection() {
+    volatile float correction = MockMeasure::instance().temperatureCorrectionMm(reading.internalTempC);
+    (void)correction;
+  }
+
+  void benchArmAutonomous() {
+    MockMeasure::instance().armAutonomousRanging(62.0);
+  }
+
+  // The console command Benchmark.cpp parses, with the same parser as jsonFunctionParser()
+  const char * const benchCommand = "{\"cmd\":[{\"var\":\"soft\",\"fn\":\"restart\"},{\"var\":\"21\",\"fn\":\"close\"}]}";
+
+  void benchCommandParse() {
+    char variable[64];
+    char function[16];
+    JsonParserStatic<1024, 80> jp;
+
+    jp.addString(benchCommand);
+    if (!jp.parse()) return;
+    const JsonParserGeneratorRK::jsmntok_t *cmdArrayContainer;
+    jp.getValueTokenByKey(jp.getOuterObject(), "cmd", cmdArrayContainer);
+    for (int i = 0; i < 10; i++) {
+      const JsonParserGeneratorRK::jsmntok_t *cmdObjectContainer = jp.getTokenByIndex(cmdArrayContainer, i);
+      if (cmdObjectContainer == NULL) break;
+      jp.getValueByKey(cmdObjectContainer, "var", variable, sizeof(variable));
+      jp.getValueByKey(cmdObjectContainer, "fn", function, sizeof(function));
+    }
+  }
+
+  void benchPayload() {
+    char data[256];
+    const EventCounters counters = {3, 0, 42, 17, 1686355199UL};
+    volatile int len = formatEventPayload(data, sizeof(data), reading, counters);
+    (void)len;
+  }
+
+  // A PersistentDataFRAM object filling a 100 byte slot, as current and sysStatus do
+  class BenchData : public StorageHelperRK::PersistentDataFRAM {
+  public:
+    struct Data {
+      StorageHelperRK::PersistentDataBase::SavedDataHeader header;
+      uint8_t values[84];
+    };
+
+    explicit BenchData(MB85RC &fram) : StorageHelperRK::PersistentDataFRAM(fram, 100, &data.header, sizeof(Data), 0x20a99e75, 1) {}
+
+    Data data;
+  };
+
+  MB85RC benchFram(8192);
+  BenchData benchData(benchFram);
+  uint32_t benchValue = 0;
+
+  void benchFramSet() {                                           // A set_ call - the hash is recomputed
+    benchData.setValue<uint32_t>(offsetof(BenchData::Data, values), ++benchValue);
+  }
+
+  void benchFramSave() {
+    benchData.save();
+  }
+
+  struct BenchStep {
+    const char *name;
+    void (*setup)();
+    void (*fn)();
+  };
+
+  const BenchStep steps[] = {
+    {"measureHeight 1 TOF", [] { setupSensors(1, MockMeasure::FUSION_MAX); }, benchOneSensor},
+    {"measureHeight 4 TOF median", [] { setupSensors(4, MockMeasure::FUSION_MEDIAN); }, benchFourSensors},
+    {"measureHeight 4 TOF weighted", [] { setupSensors(4, MockMeasure::FUSION_WEIGHTED); }, benchFourSensors},
+    {"temperatureCorrectionMm", [] {                            // With a fit to evaluate
+      setupSensors(1, MockMeasure::FUSION_MAX);
+      hostTofCal.fit = {50, 1000, 500, 25000, 11000, 960};
+    }, benchTemperatureCorrection},
+    {"armAutonomousRanging", [] { setupSensors(1, MockMeasure::FUSION_MAX); }, benchArmAutonomous},
+    {"command parse", [] {}, benchCommandParse},
+    {"sendEvent payload", [] {
+      setupSensors(1, MockMeasure::FUSION_MAX);
+      reading = {21, 56.25f, 1686355000, false, 24.5f, 5, 3.91f};
+    }, benchPayload},
+    {"FRAM set + hash (100 bytes)", [] { benchData.load(); }, benchFramSet},
+    {"FRAM save (100 bytes)", [] { benchData.load(); }, benchFramSave},
+  };
+}
+
+int main(int argc, char *argv[]) {
+  long iterations = (argc > 1) ? atol(argv[1]) : 10000;
+  if (iterations < 1) iterations = 1;
+
+#ifdef HAVE_TSC
+  printf("%-30s %10s %10s %10s %10s %10s\n", "Step", "min ns", "avg ns", "max ns", "min cyc", "avg cyc");
+#else
+  printf("%-30s %10s %10s %10s\n", "Step", "min ns", "avg ns", "max ns");
+#endif
+
+  for (const BenchStep &step : steps) {
+    step.setup();
+    step.fn();                                                    // Warm up - first call allocates the singleton
+    double totalNs = 0, minNs = 1e30, maxNs = 0;
+    double totalCycles = 0, minCycles = 1e30;
+    (void)totalCycles;
+    (void)minCycles;
+
+    for (long i = 0; i < iterations; i++) {
+#ifdef HAVE_TSC
+      unsigned long long startCycles = __rdtsc();
+#endif
+      auto start = std::chrono::steady_clock::now();
+      step.fn();
+      auto end = std::chrono::steady_clock::now();
+#ifdef HAVE_TSC
+      double cycles = (double)(__rdtsc() - startCycles);
+      totalCycles += cycles;
+      if (cycles < minCycles) minCycles = cycles;
+#endif
+      double ns = std::chrono::duration<double, std::nano>(end - start).count();
+      totalNs += ns;
+      if (ns < minNs) minNs = ns;
+      if (ns > maxNs) maxNs = ns;
+    }
+
+#ifdef HAVE_TSC
+    printf("%-30s %10.0f %10.0f %10.0f %10.0f %10.0f\n", step.name, minNs, totalNs / iterations, maxNs, minCycles, totalCycles / iterations);
+#else
+    printf("%-30s %10.0f %10.0f %10.0f\n", step.name, minNs, totalNs / iterations, maxNs);
+#endif
+  }
+  return 0;
+}
@@ -0,0 +1,60 @@
+/*
+ * @file fleet_node.cpp
+ * @brief One simulated can for tools/fleet_sim.py - the firmware's wake schedule, Measure_TrashT with the mock
+ * sensors and the webhook payload formatter, built as a shared library ("make -C tools/host fleet_node.so") and
+ * called through ctypes.  A process simulates one node at a time - nodeReset() starts the next.
+ *
+ */
+
+#include "Host_Support.h"
+#include "Mock_Sensors.h"
+#include "Measure_Trash.cpp"                              // Template members are defined there
+#include "Event_Payload.h"
+#include "Wake_Schedule.h"
+
+template class Measure_TrashT<MockRange, MockTilt>;
+typedef Measure_TrashT<MockRange, MockTilt> MockMeasure;
+
+namespace {
+  Measurement reading;                                    // Carried from report to report, as current is
+}
+
+extern "C" {
+
+int secondsToNextWake(unsigned int now, int boundary, int offset) {
+  return Wake_Schedule::secondsToNextWake(now, boundary, offset);
+}
+
+int phaseOffset(const char *deviceId, int window) {
+  return Wake_Schedule::phaseOffset(deviceId, window);
+}
+
+/**
+ * @brief A freshly installed can - sysStatus defaults, an empty log and the sensors set up again
+ *
+ */
+void nodeReset() {
+  hostReset();
+  MockRange::reset();
+  MockTilt::reset();
+  MockMeasure::instance().setup();
+  reading = Measurement();
+}
+
+/**
+ * @brief Measures the can with the TOF at distanceMm and formats the webhook payload the device would publish
+ *
+ * @returns The payload length
+ */
+int nodeReport(int distanceMm, float tempC, float vCell, int connectSecs, unsigned long timeStamp, char *payload, int len) {
+  MockRange::mm[0] = (uint16_t)distanceMm;
+  reading.internalTempC = tempC;
+  MockMeasure::instance().measureHeight(reading);
+  reading.batteryVoltage = vCell;
+  hostLog.clear();                                        // Nobody reads the records - keep a long run's memory flat
+
+  const EventCounters counters = {0, 0, connectSecs, 0, timeStamp};
+  return formatEventPayload(payload, (size_t)len, reading, counters);
+}
+
+}
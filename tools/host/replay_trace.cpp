@@ -0,0 +1,128 @@
+/*
+ * @file replay_trace.cpp
+ * @brief Replays a field trace through Measure_TrashT on the host - the TOF and accelerometer inputs the device
+ * recorded are fed to the mock sensors and each measurement the firmware makes of them is printed.
+ *
+ * Usage: tools/decode_log.py --trace < log.jsonl | tools/host/replay_trace [-t tempC] [-e trashEmpty] [-f trashFull] [-v]
+ *
+ * Each "tof" trace starts a measurement and the "accel" trace after it completes it, in the order measureHeight()
+ * records them.  The TOF distance in a trace is already fused, so it is replayed as a single sensor.  Internal
+ * temperature is not traced - the measurements are replayed at -t (25C by default).
+ *
+ * Only the sensor path is replayed.  The "vcell", "connect" and "webhook" traces feed the state handlers in
+ * Trashcan-Panda.cpp, which need Device OS (sleep, cellular, the cloud and the fuel gauge) and the FRAM objects,
+ * so they are counted and reported as not replayed rather than run through a model of those handlers.
+ *
+ */
+
+#include "Host_Support.h"
+#include "Mock_Sensors.h"
+#include "Measure_Trash.cpp"                              // Template members are defined there
+#include <stdlib.h>
+#include <string>
+
+template class Measure_TrashT<MockRange, MockTilt>;
+typedef Measure_TrashT<MockRange, MockTilt> MockMeasure;
+
+namespace {
+  const int maxArgs = 4;
+
+  // One decoded trace line - {"timestamp": ..., "sequence": ..., "type": "...", "args": [...]}
+  struct TraceLine {
+    unsigned long timestamp;
+    std::string type;
+    std::string args[maxArgs];                            // Strings without their quotes, numbers as written
+    int argCount;
+  };
+
+  // Just enough JSON for the lines decode_log.py writes
+  bool parseLine(const std::string &line, TraceLine &trace) {
+    size_t pos = line.find("\"timestamp\":");
+    trace.timestamp = (pos == std::string::npos) ? 0 : strtoul(line.c_str() + pos + 12, nullptr, 10);
+
+    pos = line.find("\"type\":");
+    if (pos == std::string::npos) return false;
+    size_t start = line.find('"', pos + 7);
+    size_t end = line.find('"', start + 1);
+    if (start == std::string::npos || end == std::string::npos) return false;
+    trace.type = line.substr(start + 1, end - start - 1);
+
+    pos = line.find("\"args\":");
+    start = line.find('[', pos);
+    end = line.find(']', start);
+    if (pos == std::string::npos || start == std::string::npos || end == std::string::npos) return false;
+    trace.argCount = 0;
+    std::string list = line.substr(start + 1, end - start - 1);
+    for (size_t from = 0; from <= list.size() && trace.argCount < maxArgs; ) {
+      size_t comma = list.find(',', from);
+      if (comma == std::string::npos) comma = list.size();
+      std::string arg = list.substr(from, comma - from);
+      size_t first = arg.find_first_not_of(" \"");
+      size_t last = arg.find_last_not_of(" \"");
+      trace.args[trace.argCount++] = (first == std::string::npos) ? "" : arg.substr(first, last - first + 1);
+      from = comma + 1;
+    }
+    return true;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  float tempC = 25.0;
+
+  hostReset();
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-v")) Log.verbose = true;
+    else if (!strcmp(argv[i], "-t") && i + 1 < argc) tempC = atof(argv[++i]);
+    else if (!strcmp(argv[i], "-e") && i + 1 < argc) hostSysStatus.trashEmpty = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-f") && i + 1 < argc) hostSysStatus.trashFull = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "Usage: %s [-t tempC] [-e trashEmpty] [-f trashFull] [-v] < trace.jsonl\n", argv[0]);
+      return 2;
+    }
+  }
+
+  MockRange::reset();
+  MockTilt::reset();
+  MockMeasure::instance().setup();
+
+  Measurement reading = {};
+  bool haveTof = false;
+  unsigned long tofTimestamp = 0;
+  int measurements = 0;
+  int vcellTraces = 0, connectTraces = 0, webhookTraces = 0;
+  char buf[512];
+
+  while (fgets(buf, sizeof(buf), stdin)) {
+    TraceLine trace;
+    if (!parseLine(buf, trace)) continue;
+
+    if (trace.type == "tof" && trace.argCount >= 2) {
+      MockRange::ready = (trace.args[0] != "not ready");
+      MockRange::mm[0] = (uint16_t)atoi(trace.args[1].c_str());
+      tofTimestamp = trace.timestamp;
+      haveTof = true;
+    }
+    else if (trace.type == "accel" && trace.argCount >= 4 && haveTof) {
+      MockTilt::present = (trace.args[0] == "ok");
+      MockTilt::x = (int16_t)atoi(trace.args[1].c_str());
+      MockTilt::y = (int16_t)atoi(trace.args[2].c_str());
+      MockTilt::z = (int16_t)atoi(trace.args[3].c_str());
+
+      reading.internalTempC = tempC;
+      MockMeasure::instance().measureHeight(reading);       // Carries percentFull over - emptied detection sees the last one
+      printf("{\"timestamp\": %lu, \"height\": %d, \"percentFull\": %.1f, \"emptied\": %d, \"lid\": %u}\n",
+        tofTimestamp, reading.trashHeight, reading.percentFull, reading.trashcanEmptied ? 1 : 0, reading.lidPosition);
+      measurements++;
+      haveTof = false;
+    }
+    else if (trace.type == "vcell") vcellTraces++;
+    else if (trace.type == "connect") connectTraces++;
+    else if (trace.type == "webhook") webhookTraces++;
+  }
+
+  fprintf(stderr, "%d measurements replayed\n", measurements);
+  if (vcellTraces + connectTraces + webhookTraces > 0) {
+    fprintf(stderr, "Not replayed: %d vcell, %d connect and %d webhook traces\n", vcellTraces, connectTraces, webhookTraces);
+  }
+  return 0;
+}
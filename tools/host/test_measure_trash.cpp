@@ -0,0 +1,240 @@
+/*
+ * @file test_measure_trash.cpp
+ * @brief Measure_TrashT with the mock sensors from Mock_Sensors.h - fill level, fusion, lid position, sensor
+ * failures and autonomous ranging thresholds.  Build and run with "make -C tools/host test".
+ *
+ */
+
+#include "Host_Support.h"
+#include "Mock_Sensors.h"
+#include "Measure_Trash.cpp"                              // Template members are defined there
+
+template class Measure_TrashT<MockRange, MockTilt>;
+typedef Measure_TrashT<MockRange, MockTilt> MockMeasure;
+
+namespace {
+  int checks = 0;
+  int failures = 0;
+
+  void check(bool ok, const char *what) {
+    checks++;
+    if (!ok) {
+      failures++;
+      fprintf(stderr, "FAIL: %s\n", what);
+    }
+  }
+
+  void reset() {
+    hostReset();
+    MockRange::reset();
+    MockTilt::reset();
+  }
+
+  // Inches from the sensor to millimetres - as the sensor reports it
+  uint16_t inchesToMm(float inches) {
+    return (uint16_t)(inches / 0.0393701 + 0.5);
+  }
+
+  Measurement measure(float lastPercentFull = 0.0, float tempC = 25.0) {
+    Measurement reading = {};
+    reading.percentFull = lastPercentFull;
+    reading.internalTempC = tempC;
+    MockMeasure::instance().measureHeight(reading);
+    return reading;
+  }
+
+  void testSetup() {
+    reset();
+    check(MockMeasure::instance().setup(), "setup with both sensors");
+    check(MockTilt::profile == ACCEL_SLEEP, "setup leaves the accelerometer in the sleep profile");
+    check(MockMeasure::instance().tofSensorCount() == 1, "one TOF sensor found");
+
+    reset();
+    MockRange::fitted = 0;
+    check(!MockMeasure::instance().setup(), "setup fails without a TOF sensor");
+
+    reset();
+    MockTilt::present = false;
+    check(!MockMeasure::instance().setup(), "setup fails without an accelerometer");
+  }
+
+  void testFillLevel() {
+    reset();
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(23.5);                   // 38" empty, 9" full - 23" of trash space left
+    Measurement reading = measure();
+    check(reading.trashHeight == 23, "trash height in inches");
+    check(fabs(reading.percentFull - 15.0 / 29.0 * 100.0) < 0.1, "percent full");
+    check(!reading.trashcanEmptied, "not emptied from empty");
+    check(reading.lidPosition == 5, "lid rightside up");
+    check(MockTilt::profile == ACCEL_SLEEP, "accelerometer back in the sleep profile");
+    check(MockRange::standbys == 1, "TOF sensor put in standby");
+
+    MockTilt::latched = true;                              // A lid movement since
+    check(MockMeasure::instance().clearAccelInterrupt() != 0, "latched movement reported");
+    check(!MockTilt::latched && MockMeasure::instance().clearAccelInterrupt() == 0, "latch released");
+    check(hostLogCount(Binary_Log::MSG_TRASH_SUMMARY) == 1, "summary logged");
+
+    MockRange::mm[0] = inchesToMm(60.0);                   // Further than the bottom of the can
+    reading = measure();
+    check(reading.trashHeight == 38 && reading.percentFull == 0.0, "clamped to empty");
+
+    MockRange::mm[0] = inchesToMm(2.0);                    // Trash above the full line
+    reading = measure();
+    check(reading.trashHeight == 9 && reading.percentFull == 100.0, "clamped to full");
+  }
+
+  void testEmptied() {
+    reset();
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(37.5);
+    check(measure(80.0).trashcanEmptied, "emptied from 80% to empty");
+    check(!measure(25.0).trashcanEmptied, "not emptied from 25%");
+
+    Measurement reading = {};                              // An emptying then a TOF timeout
+    reading.percentFull = 80.0;
+    reading.internalTempC = 25.0;
+    MockMeasure::instance().measureHeight(reading);
+    MockRange::ready = false;
+    MockMeasure::instance().measureHeight(reading);
+    check(!reading.trashcanEmptied, "a failed measurement does not repeat the last emptying");
+  }
+
+  void testFusion() {
+    reset();
+    MockRange::fitted = 3;
+    MockRange::good = 3;
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(20.5);
+    MockRange::mm[1] = inchesToMm(12.5);
+    MockRange::mm[2] = inchesToMm(30.5);
+
+    hostSysStatus.tofFusion = MockMeasure::FUSION_MAX;
+    check(measure().trashHeight == 12, "max fusion takes the fullest spot");
+
+    MockRange::mm[0] = inchesToMm(20.5);                   // Sorted in place by the last pass
+    MockRange::mm[1] = inchesToMm(12.5);
+    MockRange::mm[2] = inchesToMm(30.5);
+    hostSysStatus.tofFusion = MockMeasure::FUSION_MEDIAN;
+    check(measure().trashHeight == 20, "median fusion");
+
+    MockRange::mm[0] = inchesToMm(20.5);
+    MockRange::mm[1] = inchesToMm(12.5);
+    MockRange::mm[2] = inchesToMm(30.5);
+    MockRange::signalRate[0] = 0;
+    MockRange::signalRate[1] = 100;
+    MockRange::signalRate[2] = 0;
+    hostSysStatus.tofFusion = MockMeasure::FUSION_WEIGHTED;
+    check(measure().trashHeight == 12, "weighted fusion follows the signal");
+
+    MockRange::good = 1;                                   // Two readings dropped
+    MockRange::mm[0] = inchesToMm(20.5);
+    hostSysStatus.tofFusion = MockMeasure::FUSION_MAX;
+    check(measure().trashHeight == 20, "one good reading is used as-is");
+  }
+
+  void testLidPosition() {
+    reset();
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(23.5);
+    MockTilt::z = -16000;
+    check(measure().lidPosition == 6, "lid upside down");
+    MockTilt::z = 0;
+    MockTilt::x = 16000;
+    check(measure().lidPosition == 1, "lid on its side");
+  }
+
+  void testSensorFailures() {
+    reset();
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(23.5);
+    MockRange::ready = false;
+    unsigned long start = millis();
+    Measurement reading = measure();
+    check(millis() - start >= 10000, "waits out the ranging timeout");
+    check(reading.trashHeight == 0 && reading.percentFull == 0 && reading.lidPosition == 0, "TOF timeout zeroes the reading");
+    check(hostLogCount(Binary_Log::MSG_TOF_NOT_READY) == 1 && hostLogCount(Binary_Log::MSG_SENSORS_FAILED) == 1, "TOF timeout logged");
+
+    reset();
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(23.5);
+    MockTilt::present = false;
+    reading = measure();
+    check(reading.trashHeight == 0 && reading.lidPosition == 0, "accelerometer failure zeroes the reading");
+    check(hostLogCount(Binary_Log::MSG_ACCEL_NO_SAMPLE) == 1, "accelerometer failure logged");
+
+    reset();
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(23.5);
+    MockRange::fitted = 0;                                 // Stopped answering - measureHeight() reruns begin()
+    unsigned begins = MockRange::begins;
+    measure();
+    check(MockRange::begins == begins + 1, "a sensor that stops answering is set up again");
+  }
+
+  void testAutonomous() {
+    reset();
+    hostSysStatus.tofAutonomous = true;
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(23.5);                   // About 52% - the 50 to 75% band
+    measure();
+    check(MockRange::armed, "thresholds armed");
+    check(MockRange::lowMm < inchesToMm(38.0 - 0.75 * 29.0) && MockRange::highMm > inchesToMm(38.0 - 0.50 * 29.0), "window covers the band plus margin");
+    check(MockRange::lowMm < MockRange::mm[0] && MockRange::mm[0] < MockRange::highMm, "current reading inside the window");
+
+    hostSysStatus.tofAutonomous = false;
+    measure();
+    check(!MockRange::armed, "disarmed when autonomous ranging is off");
+  }
+
+  void testTemperatureUpdate() {
+    reset();
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(23.5);
+    measure(0.0, 20.0);
+    measure(0.0, 25.0);
+    check(MockRange::temperatureUpdates == 1, "no temperature update within 8C");
+    measure(0.0, 30.0);
+    check(MockRange::temperatureUpdates == 2, "temperature update after more than 8C");
+    measure(0.0, 120.0);
+    check(MockRange::temperatureUpdates == 2, "suspect temperatures are ignored");
+  }
+
+  void testTemperatureLearning() {
+    reset();
+    MockMeasure::instance().setup();
+    MockRange::mm[0] = inchesToMm(37.0);                   // An inch of trash in the bottom
+    for (int i = 0; i < 20; i++) measure(10.0);
+    check(hostTofCal.fit.samples == 0 && hostTofCal.fit.referenceMm == 0, "a low can is not learned as sensor error");
+
+    MockRange::mm[0] = 955;                                // 37.6" - not a whole inch
+    measure(80.0, 20.0);                                   // Just emptied
+    check(hostTofCal.fit.referenceMm == 955 && hostTofCal.fit.samples == 0, "the first emptied can is the reference");
+
+    MockRange::mm[0] = 958;
+    measure(80.0, 30.0);
+    check(hostTofCal.fit.samples == 1, "the next emptied can is learned");
+    check(fabs(hostTofCal.fit.sumE - 3.0) < 0.01, "learned error is from the reference, not trashEmpty");
+
+    MockRange::mm[0] = inchesToMm(35.0);                   // Emptied but a bag left in
+    measure(80.0);
+    check(hostTofCal.fit.samples == 1, "an emptied can far from the reference is not learned");
+  }
+}
+
+int main(int argc, char *argv[]) {
+  Log.verbose = (argc > 1 && !strcmp(argv[1], "-v"));
+
+  testSetup();
+  testFillLevel();
+  testEmptied();
+  testFusion();
+  testLidPosition();
+  testSensorFailures();
+  testAutonomous();
+  testTemperatureUpdate();
+  testTemperatureLearning();
+
+  printf("%d of %d checks passed\n", checks - failures, checks);
+  return (failures == 0) ? 0 : 1;
+}
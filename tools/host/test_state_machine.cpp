@@ -0,0 +1,183 @@
+/*
+ * @file test_state_machine.cpp
+ * @brief The application's state and transition tables from App_Machine.h run through State_Machine.h - the
+ * handlers here only record that they were called and make the transitions each test scripts.  Build and run
+ * with "make -C tools/host test".
+ *
+ */
+
+#include "App_Machine.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+namespace {
+  int checks = 0;
+  int failures = 0;
+
+  void check(bool ok, const char *what) {
+    checks++;
+    if (!ok) {
+      failures++;
+      fprintf(stderr, "FAIL: %s\n", what);
+    }
+  }
+
+  std::string calls;                                      // Handlers called since the last reset - "idleTick connectingEntry ..."
+  uint8_t tickTarget[STATE_COUNT];                        // A leaf's tick handler requests this transition - NO_TRANSITION for none
+  unsigned sensorEvents = 0;
+  unsigned switchEvents = 0;
+  uint8_t hookFrom = AppStateMachine::NO_TRANSITION;
+  uint8_t hookTo = AppStateMachine::NO_TRANSITION;
+  unsigned hookCalls = 0;
+
+  AppContext context;
+  AppStateMachine machine(appStates, appTransitions, context, appEventKey);
+
+  void called(const char *handler, uint8_t state) {
+    if (!calls.empty()) calls += " ";
+    calls += handler;
+    if (tickTarget[state] != AppStateMachine::NO_TRANSITION) machine.transition(tickTarget[state]);
+  }
+
+  void hook(AppContext &, uint8_t from, uint8_t to) {
+    hookFrom = from;
+    hookTo = to;
+    hookCalls++;
+  }
+
+  void reset(uint8_t initial) {
+    memset(tickTarget, AppStateMachine::NO_TRANSITION, sizeof(tickTarget));
+    machine.dispatchEvents();                               // Nothing left over from the last test
+    machine.takeDroppedEvents();
+    sensorEvents = switchEvents = hookCalls = 0;
+    machine.begin(initial, INITIALIZATION_STATE);
+    calls.clear();
+  }
+
+  void testTables() {
+    bool parentsOk = true;
+    for (uint8_t s = 0; s < STATE_COUNT; s++) {
+      uint8_t parent = appStates[s].parent;
+      if (parent != AppStateMachine::NO_PARENT && (parent >= STATE_COUNT || parent < LEAF_STATE_COUNT)) parentsOk = false;
+    }
+    check(parentsOk, "every parent is a composite state after the leaves");
+
+    bool eventsHandled = true;
+    for (uint8_t s = 0; s < LEAF_STATE_COUNT; s++) {
+      bool handled = false;
+      for (uint8_t p = s; p < STATE_COUNT; p = appStates[p].parent) if (appStates[p].onEvent) handled = true;
+      if (!handled) eventsHandled = false;
+    }
+    check(eventsHandled, "every leaf state or a parent handles the user switch and sensor");
+  }
+
+  void testStart() {
+    machine.withTransitionHook(hook);
+    reset(IDLE_STATE);
+    check(machine.current() == IDLE_STATE && machine.isIn(AWAKE_STATE), "starts in Idle, inside Awake");
+    check(hookFrom == INITIALIZATION_STATE && hookTo == IDLE_STATE, "start reported to the transition hook");
+  }
+
+  void testTicks() {
+    reset(IDLE_STATE);
+    machine.tick();
+    check(calls == "idleTick", "Idle ticks");
+
+    tickTarget[IDLE_STATE] = REPORTING_STATE;               // Our slot in the hour
+    tickTarget[REPORTING_STATE] = CONNECTING_STATE;
+    calls.clear();
+    machine.tick();
+    check(machine.current() == REPORTING_STATE && calls == "idleTick", "tick stops at the first transition");
+    calls.clear();
+    machine.tick();
+    check(machine.current() == CONNECTING_STATE && calls == "reportingTick connectingEntry", "Connecting entered from Reporting");
+    check(machine.previous() == REPORTING_STATE && hookFrom == REPORTING_STATE && hookTo == CONNECTING_STATE, "previous state kept for connectingEntry");
+
+    tickTarget[CONNECTING_STATE] = RESP_WAIT_STATE;
+    calls.clear();
+    machine.tick();
+    check(machine.current() == RESP_WAIT_STATE && calls == "connectingTick respWaitEntry", "Response Wait after connecting");
+
+    tickTarget[RESP_WAIT_STATE] = SLEEPING_STATE;
+    calls.clear();
+    machine.tick();
+    check(machine.current() == SLEEPING_STATE && !machine.isIn(AWAKE_STATE), "out of Awake to sleep");
+
+    unsigned hooks = hookCalls;
+    machine.transition(SLEEPING_STATE);
+    machine.tick();
+    check(hookCalls == hooks && machine.current() == SLEEPING_STATE, "a transition to the current state is ignored");
+  }
+
+  void testAlert() {
+    for (uint8_t s = 0; s < LEAF_STATE_COUNT; s++) {
+      reset(s);
+      calls.clear();
+      machine.dispatch({ALERT_EVENT, 0, 0});
+      char what[64];
+      snprintf(what, sizeof(what), "alert from state %u goes to Error", s);
+      check(machine.current() == ERROR_STATE, what);
+      snprintf(what, sizeof(what), "alert from state %u is not passed to inputEvent", s);
+      check(calls.find("inputEvent") == std::string::npos, what);
+      snprintf(what, sizeof(what), "alert from state %u runs errorEntry once", s);
+      check(calls == ((s == ERROR_STATE) ? "" : "errorEntry"), what);   // Already in Error - not entered again
+    }
+  }
+
+  void testInputEvents() {
+    reset(IDLE_STATE);
+    machine.dispatch({SENSOR_EVENT, 1000, 1});
+    check(sensorEvents == 1 && machine.current() == IDLE_STATE, "Idle passes the sensor to Awake's inputEvent");
+
+    reset(SLEEPING_STATE);
+    machine.post({USER_SWITCH_EVENT, 2000, 0});               // As the ISRs do
+    machine.post({SENSOR_EVENT, 3000, 1});
+    check(machine.eventsPending(), "posted events wait for dispatchEvents");
+    machine.dispatchEvents();
+    check(switchEvents == 1 && sensorEvents == 1 && !machine.eventsPending(), "queued events dispatched");
+
+    reset(NAPPING_STATE);
+    for (int i = 0; i < 20; i++) machine.post({SENSOR_EVENT, (uint32_t)i, 1});
+    check(machine.takeDroppedEvents() == 4, "a full queue drops and counts");
+    machine.dispatchEvents();
+    check(sensorEvents == 16, "the queued events are kept");
+  }
+}
+
+// The handlers App_Machine.h declares
+void errorEntry(AppContext &) { called("errorEntry", ERROR_STATE); }
+void errorTick(AppContext &) { called("errorTick", ERROR_STATE); }
+void idleTick(AppContext &) { called("idleTick", IDLE_STATE); }
+void sleepingTick(AppContext &) { called("sleepingTick", SLEEPING_STATE); }
+void connectingEntry(AppContext &) {
+  if (!calls.empty()) calls += " ";
+  calls += "connectingEntry";                               // Entry handlers do not take the scripted tick transition
+}
+void connectingTick(AppContext &) { called("connectingTick", CONNECTING_STATE); }
+void reportingTick(AppContext &) { called("reportingTick", REPORTING_STATE); }
+void respWaitEntry(AppContext &) {
+  if (!calls.empty()) calls += " ";
+  calls += "respWaitEntry";
+}
+void respWaitTick(AppContext &) { called("respWaitTick", RESP_WAIT_STATE); }
+
+bool inputEvent(AppContext &, const AppEvent &event) {
+  if (!calls.empty()) calls += " ";
+  calls += "inputEvent";
+  if (event.source == SENSOR_EVENT) sensorEvents++;
+  else if (event.source == USER_SWITCH_EVENT) switchEvents++;
+  else return false;
+  return true;
+}
+
+int main() {
+  testTables();
+  testStart();
+  testTicks();
+  testAlert();
+  testInputEvents();
+
+  printf("%d of %d checks passed\n", checks - failures, checks);
+  return (failures == 0) ? 0 : 1;
+}